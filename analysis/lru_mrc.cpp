@@ -0,0 +1,122 @@
+#include <algorithm>
+#include <cmath>
+#include "lru_mrc.h"
+
+// smallest Fenwick tree, grows with the number of distinct objects
+const uint64_t MRC_MIN_CAPACITY = 1 << 20;
+
+LRUMissRatioCurve::LRUMissRatioCurve(unsigned pointsPerDoubling)
+    : _nextPos(0),
+      _liveBytes(0),
+      _reqs(0),
+      _bytes(0),
+      _maxDistance(0)
+{
+    _tree.assign(MRC_MIN_CAPACITY + 1, 0);
+    // geometric grid of cache sizes from 1 byte to 2^63 bytes
+    for (uint64_t k = 0; k <= 63ull * pointsPerDoubling; k++) {
+        const uint64_t cacheSize = std::pow(2.0, double(k) / pointsPerDoubling);
+        if (_sizes.empty() || cacheSize > _sizes.back()) {
+            _sizes.push_back(cacheSize);
+        }
+    }
+    _bucketHits.assign(_sizes.size(), 0);
+    _bucketByteHits.assign(_sizes.size(), 0);
+}
+
+void LRUMissRatioCurve::add(uint64_t pos, int64_t delta)
+{
+    for (uint64_t i = pos + 1; i < _tree.size(); i += i & -i) {
+        _tree[i] += delta;
+    }
+}
+
+uint64_t LRUMissRatioCurve::prefixSum(uint64_t pos) const
+{
+    uint64_t sum = 0;
+    for (uint64_t i = pos; i > 0; i -= i & -i) {
+        sum += _tree[i];
+    }
+    return sum;
+}
+
+// renumber the live positions to 0..n-1 and rebuild the tree
+void LRUMissRatioCurve::compact()
+{
+    typedef std::unordered_map<IdType, LastRequest>::iterator EntryIt;
+    std::vector<std::pair<uint64_t, EntryIt> > live;
+    live.reserve(_lastPos.size());
+    for (auto it = _lastPos.begin(); it != _lastPos.end(); ++it) {
+        live.push_back(std::make_pair(it->second.pos, it));
+    }
+    std::sort(live.begin(), live.end(),
+              [](const std::pair<uint64_t, EntryIt>& a,
+                 const std::pair<uint64_t, EntryIt>& b) {
+                  return a.first < b.first;
+              });
+
+    const uint64_t capacity = std::max<uint64_t>(2 * live.size(), MRC_MIN_CAPACITY);
+    _tree.assign(capacity + 1, 0);
+    for (uint64_t i = 0; i < live.size(); i++) {
+        live[i].second->second.pos = i;
+        _tree[i + 1] = live[i].second->second.size;
+    }
+    // linear-time Fenwick construction
+    for (uint64_t i = 1; i <= capacity; i++) {
+        const uint64_t parent = i + (i & -i);
+        if (parent <= capacity) {
+            _tree[parent] += _tree[i];
+        }
+    }
+    _nextPos = live.size();
+}
+
+void LRUMissRatioCurve::request(IdType id, uint64_t size)
+{
+    if (_nextPos + 1 >= _tree.size()) {
+        compact();
+    }
+    _reqs++;
+    _bytes += size;
+
+    auto it = _lastPos.find(id);
+    if (it != _lastPos.end()) {
+        LastRequest& last = it->second;
+        if (last.size == size) {
+            // bytes requested since the last request, plus the object itself
+            const uint64_t distance = _liveBytes - prefixSum(last.pos + 1) + size;
+            const size_t bucket = std::lower_bound(_sizes.begin(), _sizes.end(), distance)
+                - _sizes.begin();
+            _bucketHits[bucket]++;
+            _bucketByteHits[bucket] += size;
+            _maxDistance = std::max(_maxDistance, distance);
+        }
+        // move to the most recent position (with the new size)
+        add(last.pos, -static_cast<int64_t>(last.size));
+        _liveBytes -= last.size;
+    } else {
+        it = _lastPos.insert(std::make_pair(id, LastRequest())).first;
+    }
+    it->second.pos = _nextPos;
+    it->second.size = size;
+    add(_nextPos, size);
+    _nextPos++;
+    _liveBytes += size;
+}
+
+void LRUMissRatioCurve::print(std::ostream& out) const
+{
+    uint64_t hits = 0, byteHits = 0;
+    for (size_t i = 0; i < _sizes.size(); i++) {
+        hits += _bucketHits[i];
+        byteHits += _bucketByteHits[i];
+        out << "LRU " << _sizes[i] << "  "
+            << _reqs << " " << hits << " " << double(hits) / _reqs << " "
+            << _bytes << " " << byteHits << " " << double(byteHits) / _bytes
+            << std::endl;
+        if (_sizes[i] >= _maxDistance) {
+            // larger caches only add compulsory misses
+            break;
+        }
+    }
+}
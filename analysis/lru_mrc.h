@@ -0,0 +1,64 @@
+#ifndef LRU_MRC_H
+#define LRU_MRC_H
+
+#include <cstdint>
+#include <iostream>
+#include <unordered_map>
+#include <vector>
+#include "request.h"
+
+/*
+  LRUMissRatioCurve: LRU hit ratios for all cache sizes in one pass
+
+  computes the byte-weighted stack distance of each request, i.e., the
+  total size of the distinct objects requested since the previous request
+  to the same object (including itself). An LRU cache of capacity C hits
+  a request iff its stack distance is at most C. objects are identified
+  by id, a request with another size than the previous one misses.
+
+  sizes are tracked in a Fenwick tree indexed by the time of each object's
+  last request: O(log n) time per request, O(distinct objects) memory.
+  the curve is exact at the reported cache sizes, which are spaced
+  geometrically with pointsPerDoubling points per power of two.
+
+  as with the LRU stack model, objects larger than a cache size still
+  push other objects out of that cache size; LRUCache instead rejects
+  them, so results agree for cache sizes above the largest object.
+*/
+class LRUMissRatioCurve
+{
+protected:
+    // Fenwick tree over last-request positions, holds object sizes
+    std::vector<uint64_t> _tree;
+    uint64_t _nextPos;
+    uint64_t _liveBytes;
+    // last-request position and size of every object seen so far
+    struct LastRequest
+    {
+        uint64_t pos;
+        uint64_t size;
+    };
+    std::unordered_map<IdType, LastRequest> _lastPos;
+
+    // reported cache sizes and hits per (previous size, this size] bucket
+    std::vector<uint64_t> _sizes;
+    std::vector<uint64_t> _bucketHits;
+    std::vector<uint64_t> _bucketByteHits;
+    uint64_t _reqs;
+    uint64_t _bytes;
+    uint64_t _maxDistance;
+
+    void add(uint64_t pos, int64_t delta);
+    uint64_t prefixSum(uint64_t pos) const; // sum over positions < pos
+    void compact();
+
+public:
+    explicit LRUMissRatioCurve(unsigned pointsPerDoubling);
+
+    void request(IdType id, uint64_t size);
+
+    // one line per cache size: LRU cacheSize  reqs hits ohr bytes byteHits bhr
+    void print(std::ostream& out) const;
+};
+
+#endif /* LRU_MRC_H */
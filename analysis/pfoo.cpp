@@ -0,0 +1,76 @@
+#include <string>
+#include <regex>
+#include <thread>
+#include "trace_io.h"
+#include "size_list.h"
+#include "analysis/pfoo_bound.h"
+
+using namespace std;
+
+static void usage()
+{
+  cerr << "pfoo [--threads=N] traceFile cacheSizeBytes[,cacheSizeBytes...]" << endl;
+}
+
+// upper bounds on the hit ratios of any policy on a trace (see
+// analysis/pfoo_bound.h), to judge how far the online policies are from
+// the offline optimum
+int main (int argc, char* argv[])
+{
+
+  unsigned threads = thread::hardware_concurrency();
+  regex optexp ("--(.*)=(.*)");
+  smatch opmatch;
+  vector<string> args;
+  for(int i=1; i<argc; i++) {
+    const string arg = argv[i];
+    if(arg.compare(0, 2, "--") != 0) {
+      args.push_back(arg);
+      continue;
+    }
+    if(!regex_match (arg,opmatch,optexp)) {
+      cerr << "each option needs to be in form --name=value" << endl;
+      return 1;
+    }
+    if(opmatch[1] == "threads") {
+      threads = stoul(opmatch[2]);
+    } else {
+      cerr << "unrecognized option: " << arg << endl;
+      return 1;
+    }
+  }
+  if(threads == 0)
+    threads = 1;
+
+  if(args.size() != 2) {
+    usage();
+    return 1;
+  }
+
+  vector<uint64_t> cacheSizes;
+  if(!parseSizeList(args[1], cacheSizes)) {
+    usage();
+    return 1;
+  }
+
+  unique_ptr<TraceReader> trace = TraceReader::open(args[0], true);
+  if(trace == nullptr)
+    return 1;
+
+  cerr << "running..." << endl;
+
+  FractionalOfflineBound bound;
+  const TraceRecord* batch;
+  size_t n;
+  while((n = trace->nextBatch(batch)) > 0) {
+    for(size_t i=0; i<n; i++)
+      bound.request(batch[i].id, batch[i].size);
+  }
+  if(trace->failed())
+    return 1;
+
+  cerr << "solving..." << endl;
+
+  bound.print(cout, cacheSizes, threads);
+  return 0;
+}
@@ -0,0 +1,125 @@
+#include <algorithm>
+#include <thread>
+#include "pfoo_bound.h"
+
+// sort v on up to threads threads: one segment per thread is sorted, then
+// neighboring segments are merged pairwise in parallel
+template <class T, class Less>
+static void parallelSort(std::vector<T>& v, Less less, unsigned threads)
+{
+    const size_t segments = std::max<size_t>(1, std::min<size_t>(threads, v.size() / 1024 + 1));
+    std::vector<size_t> bounds;
+    for (size_t k = 0; k <= segments; k++) {
+        bounds.push_back(v.size() * k / segments);
+    }
+    std::vector<std::thread> pool;
+    for (size_t k = 0; k < segments; k++) {
+        pool.emplace_back([&, k]() {
+                std::sort(v.begin() + bounds[k], v.begin() + bounds[k + 1], less);
+            });
+    }
+    for (auto& thread : pool) {
+        thread.join();
+    }
+    while (bounds.size() > 2) {
+        pool.clear();
+        std::vector<size_t> merged;
+        for (size_t k = 0; k + 1 < bounds.size(); k += 2) {
+            merged.push_back(bounds[k]);
+            if (k + 2 < bounds.size()) {
+                pool.emplace_back([&, k]() {
+                        std::inplace_merge(v.begin() + bounds[k], v.begin() + bounds[k + 1],
+                                           v.begin() + bounds[k + 2], less);
+                    });
+            }
+        }
+        merged.push_back(bounds.back());
+        for (auto& thread : pool) {
+            thread.join();
+        }
+        bounds.swap(merged);
+    }
+}
+
+FractionalOfflineBound::FractionalOfflineBound()
+    : _reqs(0),
+      _bytes(0)
+{
+}
+
+void FractionalOfflineBound::request(IdType id, uint64_t size)
+{
+    const LastRequest request = {_reqs, size};
+    auto inserted = _lastPos.insert(std::make_pair(id, request));
+    if (!inserted.second) {
+        LastRequest& last = inserted.first->second;
+        // a request with another size always misses
+        if (last.size == size) {
+            Interval interval = {size, _reqs - last.index};
+            _intervals.push_back(interval);
+        }
+        last = request;
+    }
+    _reqs++;
+    _bytes += size;
+}
+
+double FractionalOfflineBound::solve(uint64_t cacheSize, bool byteHits) const
+{
+    double budget = double(cacheSize) * double(_reqs);
+    double hits = 0.0;
+    for (const auto& interval : _intervals) {
+        if (interval.size > cacheSize) {
+            continue;
+        }
+        const double cost = double(interval.size) * double(interval.length);
+        const double gain = byteHits ? double(interval.size) : 1.0;
+        if (cost > budget) {
+            // the last interval fits in part
+            hits += gain * budget / cost;
+            break;
+        }
+        budget -= cost;
+        hits += gain;
+    }
+    return hits;
+}
+
+void FractionalOfflineBound::print(std::ostream& out, const std::vector<uint64_t>& cacheSizes,
+                             unsigned threads)
+{
+    std::vector<double> hits(cacheSizes.size());
+    std::vector<double> byteHits(cacheSizes.size());
+    // evaluate the cache sizes for one order of the intervals
+    auto solveAll = [&](std::vector<double>& results, bool bytes) {
+        std::vector<std::thread> pool;
+        for (unsigned t = 0; t < threads && t < cacheSizes.size(); t++) {
+            pool.emplace_back([&, t]() {
+                    for (size_t i = t; i < cacheSizes.size(); i += threads) {
+                        results[i] = solve(cacheSizes[i], bytes);
+                    }
+                });
+        }
+        for (auto& thread : pool) {
+            thread.join();
+        }
+    };
+    // ties are broken by size, so the order doesn't depend on the threads
+    parallelSort(_intervals, [](const Interval& a, const Interval& b) {
+            const double costA = double(a.size) * double(a.length);
+            const double costB = double(b.size) * double(b.length);
+            return costA < costB || (costA == costB && a.size < b.size);
+        }, threads);
+    solveAll(hits, false);
+    parallelSort(_intervals, [](const Interval& a, const Interval& b) {
+            return a.length < b.length || (a.length == b.length && a.size < b.size);
+        }, threads);
+    solveAll(byteHits, true);
+
+    for (size_t i = 0; i < cacheSizes.size(); i++) {
+        out << "PFOO-U " << cacheSizes[i] << "  "
+            << _reqs << " " << hits[i] << " " << hits[i] / _reqs << " "
+            << _bytes << " " << byteHits[i] << " " << byteHits[i] / _bytes
+            << std::endl;
+    }
+}
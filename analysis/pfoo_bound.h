@@ -0,0 +1,66 @@
+#ifndef PFOO_BOUND_H
+#define PFOO_BOUND_H
+
+#include <cstdint>
+#include <iostream>
+#include <unordered_map>
+#include <vector>
+#include "request.h"
+
+/*
+  FractionalOfflineBound: upper bounds on the object and byte hit ratios
+  of any policy, including the offline optimum for variable object sizes
+  (PFOO-U of Berger et al., "Practical Bounds on Optimal Caching with
+  Variable Object Sizes", SIGMETRICS 2018)
+
+  each request after the first to an object, of the same size as the
+  previous one, closes an interval of length (request index - index of
+  the previous request): the request hits iff
+  the object stays cached for the interval, taking size * length bytes
+  of cache space-time. a cache of capacity C offers C bytes at each of the
+  T requests; relaxing this to C * T bytes of space-time over the whole
+  trace leaves a fractional knapsack, which is solved exactly by taking
+  the intervals in ascending cost per hit (size * length for the object
+  hit ratio, length for the byte hit ratio). objects larger than C are
+  never taken.
+
+  the intervals are sorted in one segment per thread and merged, the
+  cache sizes are evaluated on parallel threads. memory: 16 bytes per
+  request plus the last request of each object.
+*/
+class FractionalOfflineBound
+{
+protected:
+    struct Interval
+    {
+        uint64_t size;
+        uint64_t length;
+    };
+
+    std::vector<Interval> _intervals;
+    // last request index and size of every object seen so far
+    struct LastRequest
+    {
+        uint64_t index;
+        uint64_t size;
+    };
+    std::unordered_map<IdType, LastRequest> _lastPos;
+    uint64_t _reqs;
+    uint64_t _bytes;
+
+    // fractional knapsack over the sorted intervals, returns the hits or
+    // (byteHits) the hit bytes
+    double solve(uint64_t cacheSize, bool byteHits) const;
+
+public:
+    FractionalOfflineBound();
+
+    void request(IdType id, uint64_t size);
+
+    // one line per cache size: PFOO-U cacheSize  reqs hits ohr bytes byteHits bhr
+    // (hits are fractional)
+    void print(std::ostream& out, const std::vector<uint64_t>& cacheSizes,
+               unsigned threads);
+};
+
+#endif /* PFOO_BOUND_H */
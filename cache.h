@@ -10,6 +10,8 @@
 #include <cstdint>
 #include <memory>
 #include "request.h"
+#include "caches/cache_object.h"
+#include "caches/expiry_wheel.h"
 
 // uncomment to enable cache debugging:
 // #define CDEBUG 1
@@ -28,10 +30,18 @@ inline void logMessage(std::string m, double x, double y, double z) {
 
 class Cache;
 
+// name=value parameters of a cache configuration
+typedef std::vector<std::pair<std::string, std::string> > CacheParams;
+
 class CacheFactory {
 public:
     CacheFactory() {}
     virtual std::unique_ptr<Cache> create_unique() = 0;
+    // policies whose type depends on a parameter choose it here, the
+    // parameters are still passed to setPar afterwards
+    virtual std::unique_ptr<Cache> create_unique_for(const CacheParams& params) {
+        return create_unique();
+    }
 };
 
 class Cache {
@@ -39,7 +49,8 @@ public:
     // create and destroy a cache
     Cache()
         : _cacheSize(0),
-          _currentSize(0)
+          _currentSize(0),
+          _ttl(0)
     {
     }
     virtual ~Cache(){};
@@ -58,6 +69,50 @@ public:
         }
     }
     virtual void setPar(std::string parName, std::string parValue) {}
+    // true for parameters that only change how fast the policy runs, not
+    // its decisions. the driver leaves them out of the random key
+    virtual bool isPerformancePar(const std::string& parName) const {
+        return false;
+    }
+    // dense-id mode: all ids are integers below idCount, so per-object state
+    // may live in flat arrays indexed by id instead of in hash tables
+    virtual void setDenseIds(uint64_t idCount) {}
+    // key of the random stream of the policy's decisions (see RandomStream),
+    // the driver derives it from the cache configuration
+    virtual void setRandomKey(uint64_t key) {}
+    // offline policies need the next access of each request (annotated trace)
+    virtual bool needsNextAccess() const {
+        return false;
+    }
+    // time-to-live of admitted objects in units of the trace's time column,
+    // 0: objects don't expire. expiry applies to replay(), a hit doesn't
+    // extend the TTL
+    virtual void setTTL(uint64_t ttl) {
+        _ttl = ttl;
+    }
+
+    // replay a batch of requests (lookup, admit on a miss), returns the hits
+    // policies composed at compile time (see caches/composed_cache.h)
+    // override this with statically bound, inlined lookup/admit calls
+    virtual uint64_t replay(const TraceRecord* batch, size_t n) {
+        SimpleRequest req(0, 0);
+        uint64_t hits = 0;
+        for (size_t i = 0; i < n; i++) {
+            req.reinit(batch[i]);
+            if (_ttl > 0) {
+                expire(req.getTime());
+            }
+            if (lookup(&req)) {
+                hits++;
+            } else {
+                admit(&req);
+                if (_ttl > 0) {
+                    startTTL(req);
+                }
+            }
+        }
+        return hits;
+    }
 
     uint64_t getCurrentSize() const {
         return(_currentSize);
@@ -70,13 +125,14 @@ public:
     static void registerType(std::string name, CacheFactory *factory) {
         get_factory_instance()[name] = factory;
     }
-    static std::unique_ptr<Cache> create_unique(std::string name) {
+    static std::unique_ptr<Cache> create_unique(std::string name,
+                                                const CacheParams& params = CacheParams()) {
         std::unique_ptr<Cache> Cache_instance;
         if(get_factory_instance().count(name) != 1) {
             std::cerr << "unkown cacheType" << std::endl;
             return nullptr;
         }
-        Cache_instance = get_factory_instance()[name]->create_unique();
+        Cache_instance = get_factory_instance()[name]->create_unique_for(params);
         return Cache_instance;
     }
 
@@ -85,6 +141,34 @@ protected:
     uint64_t _cacheSize; // size of cache in bytes
     uint64_t _currentSize; // total size of objects in cache in bytes
 
+    // TTL: expiry time of the latest admission of each object with a
+    // pending timer (the wheel's older timers of an object are stale)
+    uint64_t _ttl;
+    ExpiryWheel _expiryWheel;
+    std::unordered_map<IdType, uint64_t> _expiryTimes;
+
+    // evict the objects whose TTL has run out before a request at time now
+    void expire(uint64_t now) {
+        _expiryWheel.advance(now, [this](const ExpiryEntry& entry) {
+                auto it = _expiryTimes.find(entry.obj.id);
+                if (it == _expiryTimes.end() || it->second != entry.expiry) {
+                    return;
+                }
+                _expiryTimes.erase(it);
+                // a no-op if the policy has evicted the object already
+                SimpleRequest req(entry.obj.id, entry.obj.size);
+                evict(&req);
+            });
+    }
+
+    // start the TTL of a missed object, whether or not it was admitted
+    // (a rejected object isn't cached, so its timer finds nothing to evict)
+    void startTTL(const SimpleRequest& req) {
+        const CacheObject obj(req.getId(), req.getSize());
+        // the wheel moves expiry times in the past to its next time unit
+        _expiryTimes[obj.id] = _expiryWheel.insert(req.getTime() + _ttl, obj);
+    }
+
     // helper functions (factory pattern)
     static std::map<std::string, CacheFactory *> &get_factory_instance() {
         static std::map<std::string, CacheFactory *> map_instance;
@@ -0,0 +1,14 @@
+// compiled with -mavx2 -mfma (see Makefile), only called if the CPU has AVX2
+#include "adaptsize_kernel.h"
+
+typedef double v4d __attribute__((vector_size(32)));
+typedef int64_t v4i __attribute__((vector_size(32)));
+
+typedef ModelKernel<v4d, v4i, 4> Avx2Kernel;
+
+const AdaptSizeKernels avx2ModelKernels = {
+    "avx2",
+    Avx2Kernel::admission,
+    Avx2Kernel::occupancy,
+    Avx2Kernel::hitRatio
+};
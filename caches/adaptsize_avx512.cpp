@@ -0,0 +1,14 @@
+// compiled with -mavx512f (see Makefile), only called if the CPU has AVX-512
+#include "adaptsize_kernel.h"
+
+typedef double v8d __attribute__((vector_size(64)));
+typedef int64_t v8i __attribute__((vector_size(64)));
+
+typedef ModelKernel<v8d, v8i, 8> Avx512Kernel;
+
+const AdaptSizeKernels avx512ModelKernels = {
+    "avx512",
+    Avx512Kernel::admission,
+    Avx512Kernel::occupancy,
+    Avx512Kernel::hitRatio
+};
@@ -0,0 +1,123 @@
+#ifndef ADAPTSIZE_KERNEL_H
+#define ADAPTSIZE_KERNEL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include "adaptsize_model.h"
+
+/*
+  vector implementation of the AdaptSize model kernels, written with GCC
+  vector extensions. included by one translation unit per instruction set
+  (compiled with its -m flags), the anonymous namespace keeps the copies
+  apart.
+
+  V: W doubles, VI: W 64-bit integers of the same size
+*/
+namespace {
+
+template <class V, class VI, unsigned W>
+struct ModelKernel
+{
+    static V load(const double* p) {
+        V v;
+        memcpy(&v, p, sizeof(v));
+        return v;
+    }
+    static void store(double* p, V v) {
+        memcpy(p, &v, sizeof(v));
+    }
+    static V splat(double x) {
+        V v = {};
+        return v + x;
+    }
+    static double sum(V v) {
+        double s = 0.0;
+        for (unsigned i = 0; i < W; i++) {
+            s += v[i];
+        }
+        return s;
+    }
+
+    // exp(x), rational approximation of the Cephes library (relative
+    // error ~2e-16). x is clamped to [-708, 709], so 2^n stays normal.
+    static V exp(V x) {
+        const V lo = splat(-708.0);
+        const V hi = splat(709.0);
+        x = x < lo ? lo : x;
+        x = x > hi ? hi : x;
+        // x = n ln2 + r, n rounded to nearest in the low bits of k
+        const V magic = splat(6755399441055744.0); // 1.5 * 2^52
+        const V k = x * 1.4426950408889634073599 + magic;
+        const V n = k - magic;
+        x = x - n * 6.93145751953125E-1;
+        x = x - n * 1.42860682030941723212E-6;
+        // exp(r) = 1 + 2 P(r^2) r / (Q(r^2) - P(r^2) r)
+        const V xx = x * x;
+        const V px = x * ((1.26177193074810590878E-4 * xx + 3.02994407707441961300E-2) * xx
+                          + 9.99999999999999999910E-1);
+        const V qx = ((3.00198505138664455042E-6 * xx + 2.52448340349684104192E-3) * xx
+                      + 2.27265548208155028766E-1) * xx + 2.00000000000000000009E0;
+        x = px / (qx - px);
+        x = 1.0 + 2.0 * x;
+        // scale by 2^n via the exponent bits
+        const VI bits = (VI)k - (VI)magic;
+        const V pow2n = (V)((bits + 1023) << 52);
+        return x * pow2n;
+    }
+
+    static double admission(const double* reqCount, const double* objSize, const double* weight,
+                            double* admProb, size_t begin, size_t end, double c) {
+        const V cv = splat(c);
+        V acc = {};
+        for (size_t i = begin; i < end; i += W) {
+            const V size = load(objSize + i);
+            const V adm = exp(-size / cv);
+            store(admProb + i, adm);
+            acc += load(reqCount + i) * adm * size * load(weight + i);
+        }
+        return sum(acc);
+    }
+
+    static double occupancy(const double* reqCount, const double* objSize, const double* weight,
+                            const double* admProb, size_t begin, size_t end, double T) {
+        const V limit = splat(150.0);
+        V acc = {};
+        for (size_t i = begin; i < end; i += W) {
+            const V size = load(objSize + i);
+            const V reqTProd = load(reqCount + i) * T;
+            // above the limit the hit probability is 1, but exp is inaccurate
+            const V expTerm = exp(reqTProd > limit ? limit : reqTProd) - 1;
+            const V expAdmProd = load(admProb + i) * expTerm;
+            const V tmp = expAdmProd / (1 + expAdmProd);
+            acc += (reqTProd > limit ? size : size * tmp) * load(weight + i);
+        }
+        return sum(acc);
+    }
+
+    static double hitRatio(const double* reqCount, const double* weight, const double* admProb,
+                           size_t begin, size_t end, double T) {
+        const V zero = {};
+        const V one = splat(1.0);
+        V acc = {};
+        for (size_t i = begin; i < end; i += W) {
+            const V l = load(reqCount + i);
+            const V p = load(admProb + i);
+            // oP1 and oP2 of lru_variants.cpp
+            const V tmp01 = l * p * T * (840.0 + 60.0 * l * T + 20.0 * l*l * T*T + l*l*l * T*T*T);
+            const V tmp02 = 840.0 + 120.0 * l * (-3.0 + 7.0 * p) * T + 60.0 * l*l * (1.0 + p) * T*T
+                + 4.0 * l*l*l * (-1.0 + 5.0 * p) * T*T*T + l*l*l*l * p * T*T*T*T;
+            V tmp = tmp01 / tmp02;
+            tmp = (tmp01 != zero) & (tmp02 == zero) ? zero : tmp;
+            // comparisons are false for NaN, which propagates as in the scalar model
+            tmp = tmp < zero ? zero : tmp;
+            tmp = tmp > one ? one : tmp;
+            acc += l * tmp * load(weight + i);
+        }
+        return sum(acc);
+    }
+};
+
+} // namespace
+
+#endif /* ADAPTSIZE_KERNEL_H */
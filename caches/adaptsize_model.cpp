@@ -0,0 +1,174 @@
+#include <cmath>
+#include "adaptsize_model.h"
+
+// math model below can be directly copiedx
+// static inline double oP1(double T, double l, double p) {
+static inline double oP1(double T, double l, double p) {
+    return (l * p * T * (840.0 + 60.0 * l * T + 20.0 * l*l * T*T + l*l*l * T*T*T));
+}
+
+static inline double oP2(double T, double l, double p) {
+    return (840.0 + 120.0 * l * (-3.0 + 7.0 * p) * T + 60.0 * l*l * (1.0 + p) * T*T + 4.0 * l*l*l * (-1.0 + 5.0 * p) * T*T*T + l*l*l*l * p * T*T*T*T);
+}
+
+/*
+  scalar kernels
+*/
+static double scalarAdmission(const double* reqCount, const double* objSize, const double* weight,
+                              double* admProb, size_t begin, size_t end, double c)
+{
+    double sum_val = 0.;
+    for(size_t i=begin; i<end; i++) {
+        admProb[i] = exp(-objSize[i]/ c);
+        sum_val += reqCount[i] * admProb[i] * objSize[i] * weight[i];
+    }
+    return sum_val;
+}
+
+static double scalarOccupancy(const double* reqCount, const double* objSize, const double* weight,
+                              const double* admProb, size_t begin, size_t end, double T)
+{
+    double the_C = 0;
+    for(size_t i=begin; i<end; i++) {
+        const double reqTProd = reqCount[i]*T;
+        if(reqTProd>150) {
+            // cache hit probability = 1, but numerically inaccurate to calculate
+            the_C += objSize[i] * weight[i];
+        } else {
+            const double expTerm = exp(reqTProd) - 1;
+            const double expAdmProd = admProb[i] * expTerm;
+            const double tmp = expAdmProd / (1 + expAdmProd);
+            the_C += objSize[i] * tmp * weight[i];
+        }
+    }
+    return the_C;
+}
+
+static double scalarHitRatio(const double* reqCount, const double* weight, const double* admProb,
+                             size_t begin, size_t end, double T)
+{
+    double weighted_hitratio_sum = 0;
+    for(size_t i=begin; i<end; i++) {
+        const double tmp01= oP1(T,reqCount[i],admProb[i]);
+        const double tmp02= oP2(T,reqCount[i],admProb[i]);
+        double tmp;
+        if(tmp01!=0 && tmp02==0)
+            tmp = 0.0;
+        else tmp= tmp01/tmp02;
+        if(tmp<0.0)
+            tmp = 0.0;
+        else if (tmp>1.0)
+            tmp = 1.0;
+        weighted_hitratio_sum += reqCount[i] * tmp * weight[i];
+    }
+    return weighted_hitratio_sum;
+}
+
+const AdaptSizeKernels scalarModelKernels = {
+    "scalar",
+    scalarAdmission,
+    scalarOccupancy,
+    scalarHitRatio
+};
+
+static const AdaptSizeKernels& selectKernels()
+{
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx512f")) {
+        return avx512ModelKernels;
+    } else if(__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        return avx2ModelKernels;
+    }
+    return scalarModelKernels;
+}
+
+const AdaptSizeKernels& modelKernels()
+{
+    static const AdaptSizeKernels& kernels = selectKernels();
+    return kernels;
+}
+
+ModelPool::ModelPool(unsigned threads)
+    : _generation(0)
+    , _stop(false)
+    , _active(0)
+    , _pass(nullptr)
+    , _n(0)
+    , _chunks(0)
+    , _nextChunk(0)
+{
+    for(unsigned t=1; t<threads; t++) {
+        _threads.emplace_back(&ModelPool::work, this);
+    }
+}
+
+ModelPool::~ModelPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stop = true;
+    }
+    _start.notify_all();
+    for(auto& thread : _threads) {
+        thread.join();
+    }
+}
+
+void ModelPool::runChunks()
+{
+    size_t c;
+    while((c = _nextChunk.fetch_add(1)) < _chunks) {
+        const size_t end = (c+1)*MODEL_CHUNK < _n ? (c+1)*MODEL_CHUNK : _n;
+        _chunkSums[c] = (*_pass)(c*MODEL_CHUNK, end);
+    }
+}
+
+void ModelPool::work()
+{
+    uint64_t seen = 0;
+    std::unique_lock<std::mutex> lock(_mutex);
+    while(true) {
+        _start.wait(lock, [&] { return _stop || _generation != seen; });
+        if(_stop) {
+            return;
+        }
+        seen = _generation;
+        lock.unlock();
+        runChunks();
+        lock.lock();
+        if(--_active == 0) {
+            _done.notify_one();
+        }
+    }
+}
+
+double ModelPool::sum(size_t n, const std::function<double(size_t, size_t)>& pass)
+{
+    const size_t chunks = (n + MODEL_CHUNK - 1) / MODEL_CHUNK;
+    if(chunks <= 1) {
+        return pass(0, n);
+    }
+    _pass = &pass;
+    _n = n;
+    _chunks = chunks;
+    _chunkSums.assign(chunks, 0.0);
+    _nextChunk = 0;
+    if(!_threads.empty()) {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _active = _threads.size();
+            _generation++;
+        }
+        _start.notify_all();
+    }
+    runChunks();
+    if(!_threads.empty()) {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _done.wait(lock, [this] { return _active == 0; });
+    }
+    double sum = 0;
+    for(const double s : _chunkSums) {
+        sum += s;
+    }
+    return sum;
+}
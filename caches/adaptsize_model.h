@@ -0,0 +1,91 @@
+#ifndef ADAPTSIZE_MODEL_H
+#define ADAPTSIZE_MODEL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+  AdaptSize model kernels: the passes of AdaptSizeAdmission::modelHitRate
+  over the aligned per-object arrays (request rate, size, weight,
+  admission probability), each over the elements [begin, end). an element
+  stands for weight objects of the same rate and size (1 for exact
+  statistics, the object count of a histogram bin otherwise).
+
+    admission   stores admProb = exp(-size/c),
+                returns the sum of reqCount * admProb * size
+    occupancy   returns the expected bytes in the cache for the
+                characteristic time T (Che approximation)
+    hitRatio    returns the request-weighted sum of hit probabilities
+
+  there are scalar, AVX2 and AVX-512 versions; the arrays are padded with
+  zeros to a multiple of MODEL_PADDING elements, so the vector versions
+  need no scalar tail
+*/
+
+// array length granularity (elements of the widest vector)
+const size_t MODEL_PADDING = 8;
+// elements per chunk of a parallel pass, a multiple of MODEL_PADDING
+const size_t MODEL_CHUNK = 1 << 14;
+
+struct AdaptSizeKernels
+{
+    const char* name;
+    double (*admission)(const double* reqCount, const double* objSize, const double* weight,
+                        double* admProb, size_t begin, size_t end, double c);
+    double (*occupancy)(const double* reqCount, const double* objSize, const double* weight,
+                        const double* admProb, size_t begin, size_t end, double T);
+    double (*hitRatio)(const double* reqCount, const double* weight, const double* admProb,
+                       size_t begin, size_t end, double T);
+};
+
+extern const AdaptSizeKernels scalarModelKernels;
+extern const AdaptSizeKernels avx2ModelKernels;
+extern const AdaptSizeKernels avx512ModelKernels;
+
+// the fastest kernels the CPU supports
+const AdaptSizeKernels& modelKernels();
+
+/*
+  ModelPool: persistent threads for the passes of the AdaptSize model
+
+  sum splits [0, n) into chunks of MODEL_CHUNK elements, which the
+  calling thread and threads - 1 pool threads take in turn. the chunk
+  sums are added in order, so the result doesn't depend on the number of
+  threads. one sum at a time; the pool threads sleep between sums.
+*/
+class ModelPool
+{
+protected:
+    std::vector<std::thread> _threads;
+    std::mutex _mutex;
+    std::condition_variable _start;
+    std::condition_variable _done;
+    uint64_t _generation; // counts the sums, wakes the pool threads
+    bool _stop;
+    unsigned _active; // pool threads still working on the current sum
+
+    // the current sum
+    const std::function<double(size_t, size_t)>* _pass;
+    size_t _n;
+    size_t _chunks;
+    std::atomic<size_t> _nextChunk;
+    std::vector<double> _chunkSums;
+
+    void runChunks();
+    void work();
+
+public:
+    explicit ModelPool(unsigned threads);
+    ~ModelPool();
+
+    // sum of pass(begin, end) over the chunks of [0, n)
+    double sum(size_t n, const std::function<double(size_t, size_t)>& pass);
+};
+
+#endif /* ADAPTSIZE_MODEL_H */
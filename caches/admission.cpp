@@ -0,0 +1,61 @@
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <iostream>
+#include "admission.h"
+
+/*
+  AdmitThreshold: admit objects smaller than a size threshold
+*/
+bool AdmitThreshold::setPar(const std::string& parName, const std::string& parValue) {
+    if(parName.compare("t") == 0) {
+        const double t = stof(parValue);
+        assert(t>0);
+        _sizeThreshold = pow(2.0,t);
+        return true;
+    }
+    return false;
+}
+
+/*
+  AdmitExpProb: admit with a probability exponentially decreasing with size
+*/
+bool AdmitExpProb::setPar(const std::string& parName, const std::string& parValue) {
+    if(parName.compare("c") == 0) {
+        const double c = stof(parValue);
+        assert(c>0);
+        _cParam = pow(2.0,c);
+        _admissionTable.build(_cParam);
+        return true;
+    }
+    return false;
+}
+
+/*
+  AdmitNHit: admit only after N requests
+*/
+bool AdmitNHit::setPar(const std::string& parName, const std::string& parValue) {
+    if(parName.compare("n") == 0) {
+        const uint64_t n = std::stoull(parValue);
+        assert(n>0);
+        _nParam = n;
+    } else if(parName.compare("w") == 0) {
+        _width = std::stoull(parValue);
+    } else if(parName.compare("d") == 0) {
+        _depth = std::stoul(parValue);
+        assert(_depth>0);
+    } else if(parName.compare("s") == 0) {
+        _sampleSize = std::stoull(parValue);
+    } else {
+        return false;
+    }
+    // the sketch's estimates saturate, a larger n would never admit
+    _sketchThreshold = std::min(_nParam, SKETCH_MAX_ESTIMATE - 1);
+    if(_width > 0) {
+        _sketch.resize(_width, _depth, _sampleSize);
+    } else {
+        // exact counts only
+        _sketch.release();
+    }
+    return true;
+}
@@ -0,0 +1,163 @@
+#ifndef ADMISSION_H
+#define ADMISSION_H
+
+#include <cmath>
+#include <string>
+#include <unordered_map>
+#include <random>
+#include "cache.h"
+#include "cache_object.h"
+#include "count_min_sketch.h"
+#include "admission_table.h"
+#include "../random_helper.h"
+
+/*
+  Admission filters for ComposedCache
+*/
+
+/*
+  AdmitAlways: admit every missed object
+*/
+struct AdmitAlways
+{
+    bool setPar(const std::string& parName, const std::string& parValue) {
+        return false;
+    }
+    bool isPerformancePar(const std::string& parName) const {
+        return false;
+    }
+    void setDenseIds(uint64_t idCount) {
+    }
+    void setRandomKey(uint64_t key) {
+    }
+    void onLookup(SimpleRequest* req, const Cache& cache) {
+    }
+    bool admit(SimpleRequest* req, const Cache& cache) {
+        return true;
+    }
+};
+
+/*
+  AdmitThreshold: admit objects smaller than a size threshold
+*/
+class AdmitThreshold
+{
+protected:
+    uint64_t _sizeThreshold;
+
+public:
+    AdmitThreshold()
+        : _sizeThreshold(524288)
+    {
+    }
+
+    // t: log2 of the size threshold
+    bool setPar(const std::string& parName, const std::string& parValue);
+    bool isPerformancePar(const std::string& parName) const {
+        return false;
+    }
+    void setDenseIds(uint64_t idCount) {
+    }
+    void setRandomKey(uint64_t key) {
+    }
+    void onLookup(SimpleRequest* req, const Cache& cache) {
+    }
+    bool admit(SimpleRequest* req, const Cache& cache) {
+        return req->getSize() < _sizeThreshold;
+    }
+};
+
+/*
+  AdmitExpProb: admit with a probability exponentially decreasing with size
+*/
+class AdmitExpProb
+{
+protected:
+    double _cParam;
+    ExpAdmissionTable _admissionTable;
+    RandomStream _random;
+
+public:
+    AdmitExpProb()
+        : _cParam(262144)
+    {
+        _admissionTable.build(_cParam);
+    }
+
+    // c: log2 of the exponential's scale parameter
+    bool setPar(const std::string& parName, const std::string& parValue);
+    bool isPerformancePar(const std::string& parName) const {
+        return false;
+    }
+    void setDenseIds(uint64_t idCount) {
+    }
+    void setRandomKey(uint64_t key) {
+        _random.seed(key);
+    }
+    void onLookup(SimpleRequest* req, const Cache& cache) {
+    }
+    bool admit(SimpleRequest* req, const Cache& cache) {
+        // admit to cache with probablity that is exponentially decreasing with size
+        return _random() < _admissionTable.threshold(req->getSize());
+    }
+};
+
+/*
+  AdmitNHit: admit only after N requests
+
+  requests are counted in a count-min sketch of fixed size, which ages
+  its counts (see caches/count_min_sketch.h). its counters saturate, so
+  n is capped at SKETCH_MAX_ESTIMATE - 1. width 0 counts exactly in a
+  hash table that keeps every object ever requested, without a sketch.
+*/
+class AdmitNHit
+{
+protected:
+    uint64_t _nParam;
+    uint64_t _sketchThreshold; // _nParam, capped at the largest estimate - 1
+    uint64_t _width;
+    uint32_t _depth;
+    uint64_t _sampleSize;
+    CountMinSketch _sketch;
+    std::unordered_map<CacheObject, uint64_t> _filter;
+
+public:
+    AdmitNHit()
+        : _nParam(2),
+          _sketchThreshold(2),
+          _width(1 << 20),
+          _depth(4),
+          _sampleSize(0),
+          _sketch(_width, _depth, _sampleSize)
+    {
+    }
+
+    // n: number of requests before admission (at most 65535 with a sketch)
+    // w, d: width (counters per row) and depth (rows) of the sketch
+    // s: requests between agings of the sketch (default 10 * width)
+    bool setPar(const std::string& parName, const std::string& parValue);
+    bool isPerformancePar(const std::string& parName) const {
+        return false;
+    }
+    void setDenseIds(uint64_t idCount) {
+    }
+    void setRandomKey(uint64_t key) {
+    }
+    void onLookup(SimpleRequest* req, const Cache& cache) {
+        CacheObject obj(req);
+        if (_width > 0) {
+            _sketch.add(std::hash<CacheObject>()(obj));
+        } else {
+            _filter[obj]++;
+        }
+    }
+    bool admit(SimpleRequest* req, const Cache& cache) {
+        CacheObject obj(req);
+        if (_width > 0) {
+            return _sketch.estimate(std::hash<CacheObject>()(obj)) > _sketchThreshold;
+        }
+        return _filter[obj] > _nParam;
+    }
+};
+
+#endif /* ADMISSION_H */
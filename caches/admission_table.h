@@ -0,0 +1,68 @@
+#ifndef ADMISSION_TABLE_H
+#define ADMISSION_TABLE_H
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+/*
+  ExpAdmissionTable: the admission probabilities exp(-size/c) by quantized
+  log2 size, as thresholds for raw 64-bit random draws
+
+  sizes below 2^ADMISSION_SUB_BITS have an entry each, larger sizes fall
+  into 2^ADMISSION_SUB_BITS bins per power of two (the bits after the
+  leading one). an entry holds the probability at the bin's midpoint,
+  scaled to 2^64, so admitting is a table load and an integer comparison
+  (relative size error below 2^-(ADMISSION_SUB_BITS+1)).
+*/
+const unsigned ADMISSION_SUB_BITS = 6;
+
+class ExpAdmissionTable
+{
+protected:
+    static const uint64_t SUB_BINS = 1 << ADMISSION_SUB_BITS;
+
+    double _c;
+    std::vector<uint64_t> _thresholds;
+
+    static size_t index(uint64_t size) {
+        if (size < SUB_BINS) {
+            return size;
+        }
+        const unsigned log2Size = 63 - __builtin_clzll(size);
+        const uint64_t sub = (size >> (log2Size - ADMISSION_SUB_BITS)) & (SUB_BINS - 1);
+        return ((log2Size - ADMISSION_SUB_BITS + 1) << ADMISSION_SUB_BITS) | sub;
+    }
+
+public:
+    ExpAdmissionTable()
+        : _c(0.0),
+          _thresholds((64 - ADMISSION_SUB_BITS + 1) << ADMISSION_SUB_BITS, 0)
+    {
+    }
+
+    double c() const {
+        return _c;
+    }
+
+    void build(double c) {
+        _c = c;
+        for (size_t i = 0; i < _thresholds.size(); i++) {
+            double size = i;
+            if (i >= SUB_BINS) {
+                const int log2Size = (i >> ADMISSION_SUB_BITS) + ADMISSION_SUB_BITS - 1;
+                const uint64_t sub = i & (SUB_BINS - 1);
+                size = std::ldexp(SUB_BINS + sub + 0.5, log2Size - ADMISSION_SUB_BITS);
+            }
+            const double threshold = std::ldexp(std::exp(-size / c), 64);
+            _thresholds[i] = threshold < 18446744073709551615.0 ? uint64_t(threshold) : UINT64_MAX;
+        }
+    }
+
+    // admit if a uniform 64-bit draw is below the threshold
+    uint64_t threshold(uint64_t size) const {
+        return _thresholds[index(size)];
+    }
+};
+
+#endif /* ADMISSION_TABLE_H */
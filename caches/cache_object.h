@@ -9,14 +9,25 @@ struct CacheObject
     IdType id;
     uint64_t size;
 
+    CacheObject()
+        : id(0),
+          size(0)
+    {}
+
     CacheObject(SimpleRequest* req)
         : id(req->getId()),
           size(req->getSize())
     {}
 
-    // comparison is based on all three properties
+    CacheObject(IdType id, uint64_t size)
+        : id(id),
+          size(size)
+    {}
+
+    // objects are identified by id alone, a request with another size
+    // refers to a new version of the same object
     bool operator==(const CacheObject &rhs) const {
-        return (rhs.id == id) && (rhs.size == size);
+        return rhs.id == id;
     }
 };
 
@@ -34,10 +45,7 @@ namespace std
     {
         inline size_t operator()(const CacheObject cobj) const
         {
-            size_t seed = 0;
-            hash_combine<IdType>(seed, cobj.id);
-            hash_combine<uint64_t>(seed, cobj.size);
-            return seed;
+            return std::hash<IdType>()(cobj.id);
         }
     };
 }
@@ -54,4 +62,15 @@ inline void hash_combine(std::size_t & seed, const T & v)
     seed ^= hasher(v) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
 }
 
+// MurmurHash3 finalizer, spreads (dense) ids and hashes over all 64 bits
+inline uint64_t mixHash(uint64_t h)
+{
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
 #endif /* CACHE_HASH_H */
@@ -0,0 +1,93 @@
+#ifndef COMPOSED_CACHE_H
+#define COMPOSED_CACHE_H
+
+#include <iostream>
+#include <string>
+#include "cache.h"
+
+/*
+  ComposedCache: an eviction order and an admission filter, composed at
+  compile time into one final class
+
+  Order is a Cache that implements the eviction order (see ListCache,
+  GreedyDualOrder) and accepts its own parameters via setOrderPar.
+  Admission decides which missed objects enter the cache:
+    bool setPar(name, value)        false for unknown parameters
+    bool isPerformancePar(name)     see Cache::isPerformancePar
+    void setDenseIds(idCount)       dense-id mode (see Cache::setDenseIds)
+    void setRandomKey(key)          key of its random stream
+    void onLookup(req, cache)       sees every request before the lookup
+    bool admit(req, cache)          true if the missed object is admitted
+
+  all calls on the replay path are statically bound, so replay() inlines
+  the complete per-request path of a policy.
+*/
+template <class Order, class Admission>
+class ComposedCache final : public Order
+{
+protected:
+    Admission _admission;
+
+public:
+    ComposedCache()
+        : Order()
+    {
+    }
+    virtual ~ComposedCache()
+    {
+    }
+
+    virtual void setPar(std::string parName, std::string parValue) {
+        if (!_admission.setPar(parName, parValue)
+            && !Order::setOrderPar(parName, parValue)) {
+            std::cerr << "unrecognized parameter: " << parName << std::endl;
+        }
+    }
+
+    virtual bool isPerformancePar(const std::string& parName) const {
+        return _admission.isPerformancePar(parName);
+    }
+
+    virtual void setDenseIds(uint64_t idCount) {
+        Order::setDenseIds(idCount);
+        _admission.setDenseIds(idCount);
+    }
+
+    virtual void setRandomKey(uint64_t key) {
+        Order::setRandomKey(key);
+        _admission.setRandomKey(key);
+    }
+
+    virtual bool lookup(SimpleRequest* req) {
+        _admission.onLookup(req, *this);
+        return Order::lookup(req);
+    }
+
+    virtual void admit(SimpleRequest* req) {
+        if (_admission.admit(req, *this)) {
+            Order::admit(req);
+        }
+    }
+
+    virtual uint64_t replay(const TraceRecord* batch, size_t n) {
+        SimpleRequest req(0, 0);
+        uint64_t hits = 0;
+        for (size_t i = 0; i < n; i++) {
+            req.reinit(batch[i]);
+            if (this->_ttl > 0) {
+                this->expire(req.getTime());
+            }
+            if (ComposedCache::lookup(&req)) {
+                hits++;
+            } else {
+                ComposedCache::admit(&req);
+                if (this->_ttl > 0) {
+                    this->startTTL(req);
+                }
+            }
+        }
+        return hits;
+    }
+};
+
+#endif /* COMPOSED_CACHE_H */
@@ -0,0 +1,154 @@
+#ifndef COUNT_MIN_SKETCH_H
+#define COUNT_MIN_SKETCH_H
+
+#include <cstdint>
+#include <vector>
+#include "cache_object.h" /* mixHash */
+
+/*
+  CountMinSketch: approximate request counts in a fixed memory budget
+  (TinyLFU-style frequency estimator)
+
+  depth rows of width saturating 16-bit counters; a key's count is the
+  minimum of its counters in all rows, and an update only increments the
+  counters that equal that minimum (conservative update).
+  a doorkeeper Bloom filter (8 bits per counter of a row) absorbs the first request of each key, so
+  one-hit wonders never reach the counters.
+  after sampleSize additions all counters are halved and the doorkeeper
+  is cleared (aging), so the estimates follow changing popularity.
+*/
+// largest estimate: the doorkeeper bit plus a saturated counter
+const uint64_t SKETCH_MAX_ESTIMATE = UINT16_MAX + 1;
+
+class CountMinSketch
+{
+protected:
+    uint64_t _mask; // width - 1
+    uint64_t _doorkeeperMask; // 8 * width - 1
+    uint32_t _depth;
+    uint64_t _sampleSize;
+    uint64_t _additions;
+    std::vector<uint16_t> _counters; // row-major, depth x width
+    std::vector<uint64_t> _doorkeeper; // 8 * width bits
+
+    // counter index of key in row, double hashing from two mixed hashes
+    uint64_t index(uint64_t h1, uint64_t h2, uint32_t row) const {
+        return (h1 + row * h2) & _mask;
+    }
+    uint64_t doorkeeperBit(uint64_t h1, uint64_t h2, uint32_t row) const {
+        return (h1 + row * h2) & _doorkeeperMask;
+    }
+
+    bool doorkeeperHas(uint64_t bit) const {
+        return (_doorkeeper[bit >> 6] >> (bit & 63)) & 1;
+    }
+
+    void reset() {
+        for (auto& c : _counters) {
+            c >>= 1;
+        }
+        for (auto& w : _doorkeeper) {
+            w = 0;
+        }
+        _additions /= 2;
+    }
+
+public:
+    // width is rounded up to a power of two (and at least 64)
+    // sampleSize 0: ten additions per counter of a row
+    CountMinSketch(uint64_t width = 1 << 20, uint32_t depth = 4, uint64_t sampleSize = 0)
+        : _depth(0),
+          _sampleSize(0),
+          _additions(0)
+    {
+        resize(width, depth, sampleSize);
+    }
+
+    // drops all counts
+    void resize(uint64_t width, uint32_t depth, uint64_t sampleSize) {
+        uint64_t w = 64;
+        while (w < width) {
+            w <<= 1;
+        }
+        _mask = w - 1;
+        _doorkeeperMask = 8 * w - 1;
+        _depth = depth;
+        _sampleSize = sampleSize > 0 ? sampleSize : 10 * w;
+        _additions = 0;
+        _counters.assign(w * depth, 0);
+        _doorkeeper.assign(w / 8, 0);
+    }
+
+    // frees the counters, the sketch must be resized before the next use
+    void release() {
+        std::vector<uint16_t>().swap(_counters);
+        std::vector<uint64_t>().swap(_doorkeeper);
+    }
+
+    uint64_t getWidth() const {
+        return _mask + 1;
+    }
+    uint32_t getDepth() const {
+        return _depth;
+    }
+
+    void add(uint64_t key) {
+        const uint64_t h1 = mixHash(key);
+        const uint64_t h2 = mixHash(h1) | 1;
+        // first request: only the doorkeeper
+        bool seen = true;
+        for (uint32_t row = 0; row < _depth; row++) {
+            const uint64_t bit = doorkeeperBit(h1, h2, row);
+            if (!doorkeeperHas(bit)) {
+                seen = false;
+                _doorkeeper[bit >> 6] |= uint64_t(1) << (bit & 63);
+            }
+        }
+        if (seen) {
+            // conservative update: raise only the minimal counters
+            uint16_t* counters = _counters.data();
+            uint16_t minCount = UINT16_MAX;
+            for (uint32_t row = 0; row < _depth; row++) {
+                const uint16_t c = counters[index(h1, h2, row)];
+                minCount = c < minCount ? c : minCount;
+                counters += _mask + 1;
+            }
+            if (minCount < UINT16_MAX) {
+                counters = _counters.data();
+                for (uint32_t row = 0; row < _depth; row++) {
+                    uint16_t& c = counters[index(h1, h2, row)];
+                    if (c == minCount) {
+                        c++;
+                    }
+                    counters += _mask + 1;
+                }
+            }
+        }
+        if (++_additions >= _sampleSize) {
+            reset();
+        }
+    }
+
+    // estimated number of additions of key: the doorkeeper bit plus the
+    // counters (never underestimated before the first aging)
+    uint64_t estimate(uint64_t key) const {
+        const uint64_t h1 = mixHash(key);
+        const uint64_t h2 = mixHash(h1) | 1;
+        uint64_t count = 1;
+        for (uint32_t row = 0; row < _depth; row++) {
+            if (!doorkeeperHas(doorkeeperBit(h1, h2, row))) {
+                count = 0;
+            }
+        }
+        const uint16_t* counters = _counters.data();
+        uint16_t minCount = UINT16_MAX;
+        for (uint32_t row = 0; row < _depth; row++) {
+            const uint16_t c = counters[index(h1, h2, row)];
+            minCount = c < minCount ? c : minCount;
+            counters += _mask + 1;
+        }
+        return count + minCount;
+    }
+};
+
+#endif /* COUNT_MIN_SKETCH_H */
@@ -0,0 +1,137 @@
+#ifndef EXPIRY_WHEEL_H
+#define EXPIRY_WHEEL_H
+
+#include <cstdint>
+#include <vector>
+#include "cache_object.h"
+
+/*
+  ExpiryWheel: hierarchical timing wheel of object expiry times
+
+  EXPIRY_LEVELS levels of 256 slots. an entry sits on the level of the
+  highest byte in which its expiry time differs from the current time, in
+  the slot of that byte. advancing the time expires the slots passed over
+  and moves the entries of the slot reached on the highest changed level
+  down (cascading), so an entry is moved at most once per level: O(1)
+  amortized per entry, independent of the time between requests.
+  occupancy bitmaps skip the empty slots, the slots are allocated on the
+  first insert.
+*/
+const unsigned EXPIRY_LEVELS = 8;
+
+struct ExpiryEntry
+{
+    uint64_t expiry;
+    CacheObject obj;
+};
+
+class ExpiryWheel
+{
+protected:
+    static const unsigned SLOT_BITS = 8;
+    static const unsigned SLOTS = 1 << SLOT_BITS;
+
+    uint64_t _now;
+    std::vector<std::vector<ExpiryEntry> > _slots; // level-major
+    uint64_t _occupied[EXPIRY_LEVELS][SLOTS / 64];
+    std::vector<ExpiryEntry> _cascade;
+
+    static unsigned slotOf(uint64_t time, unsigned level) {
+        return (time >> (level * SLOT_BITS)) & (SLOTS - 1);
+    }
+
+    // expiry > _now
+    void place(const ExpiryEntry& entry) {
+        const unsigned level = (63 - __builtin_clzll(entry.expiry ^ _now)) / SLOT_BITS;
+        const unsigned slot = slotOf(entry.expiry, level);
+        _slots[level * SLOTS + slot].push_back(entry);
+        _occupied[level][slot / 64] |= 1ULL << (slot % 64);
+    }
+
+    // calls f(slot) for the occupied slots in [first, last) of a level
+    template <class F>
+    void forOccupied(unsigned level, unsigned first, unsigned last, F f) {
+        for (unsigned w = first / 64; w < SLOTS / 64 && w * 64 < last; w++) {
+            uint64_t bits = _occupied[level][w];
+            while (bits != 0) {
+                const unsigned slot = w * 64 + __builtin_ctzll(bits);
+                bits &= bits - 1;
+                if (slot >= first && slot < last) {
+                    f(slot);
+                }
+            }
+        }
+    }
+
+    template <class F>
+    void expireSlot(unsigned level, unsigned slot, F& expire) {
+        std::vector<ExpiryEntry>& entries = _slots[level * SLOTS + slot];
+        for (const auto& entry : entries) {
+            expire(entry);
+        }
+        entries.clear();
+        _occupied[level][slot / 64] &= ~(1ULL << (slot % 64));
+    }
+
+public:
+    ExpiryWheel()
+        : _now(0)
+    {
+        for (auto& level : _occupied) {
+            for (auto& word : level) {
+                word = 0;
+            }
+        }
+    }
+
+    // expiry times not after the current time count as the next time unit,
+    // returns the expiry time of the entry
+    uint64_t insert(uint64_t expiry, const CacheObject& obj) {
+        if (_slots.empty()) {
+            _slots.resize(EXPIRY_LEVELS * SLOTS);
+        }
+        ExpiryEntry entry = {expiry > _now ? expiry : _now + 1, obj};
+        place(entry);
+        return entry.expiry;
+    }
+
+    // move the current time forward to now, calling expire(entry) for each
+    // entry with expiry <= now. times before the current time are ignored
+    template <class F>
+    void advance(uint64_t now, F expire) {
+        if (now <= _now || _slots.empty()) {
+            _now = now > _now ? now : _now;
+            return;
+        }
+        const unsigned top = (63 - __builtin_clzll(now ^ _now)) / SLOT_BITS;
+        // below the highest changed level all entries are due
+        for (unsigned level = 0; level < top; level++) {
+            forOccupied(level, 0, SLOTS, [&](unsigned slot) {
+                    expireSlot(level, slot, expire);
+                });
+        }
+        // on the highest changed level the slots passed over are due, the
+        // slot reached is cascaded
+        const unsigned reached = slotOf(now, top);
+        forOccupied(top, slotOf(_now, top) + 1, reached, [&](unsigned slot) {
+                expireSlot(top, slot, expire);
+            });
+        _now = now;
+        std::vector<ExpiryEntry>& entries = _slots[top * SLOTS + reached];
+        if (entries.empty()) {
+            return;
+        }
+        _cascade.swap(entries);
+        _occupied[top][reached / 64] &= ~(1ULL << (reached % 64));
+        for (const auto& entry : _cascade) {
+            if (entry.expiry <= now) {
+                expire(entry);
+            } else {
+                place(entry);
+            }
+        }
+        _cascade.clear();
+    }
+};
+
+#endif /* EXPIRY_WHEEL_H */
@@ -2,146 +2,368 @@
 #define GD_VARIANTS_H
 
 #include <unordered_map>
-#include <map>
+#include <vector>
 #include <queue>
 #include "cache.h"
 #include "cache_object.h"
+#include "object_index.h"
+#include "indexed_heap.h"
+#include "ghost_table.h"
+#include "admission.h"
+#include "composed_cache.h"
 
-typedef std::multimap<long double, CacheObject> ValueMapType;
-typedef ValueMapType::iterator ValueMapIteratorType;
-typedef std::unordered_map<CacheObject, ValueMapIteratorType> GdCacheMapType;
-typedef std::unordered_map<CacheObject, uint64_t> CacheStatsMapType;
+/*
+  GD value functions for GreedyDualOrder
+
+    State                               per-object state, stored in the
+                                        object's GD entry while it is cached
+    bool setPar(name, value)            false for unknown parameters
+    void onLookup(obj)                  before every lookup
+    void onAdmit(obj, state)            initializes the state of a new entry
+    double value(obj, state, currentL)  GD value on admission and on each hit
+    void afterHit(obj, state)           after the value update of a hit
+    void onEvict(obj, state)            when obj leaves the cache
+
+  hooks a value function doesn't need are inherited from GDValue
+*/
 
 /*
-  GD: greedy dual eviction (base class)
+  GD: greedy dual, every object gets the same value
+*/
+struct GDValue
+{
+    struct State
+    {
+    };
 
-  [implementation via heap: O(log n) time for each cache miss]
+    bool setPar(const std::string& parName, const std::string& parValue) {
+        return false;
+    }
+    void onLookup(const CacheObject& obj) {
+    }
+    // state hooks take the State of the derived value function
+    template <class S>
+    void onAdmit(const CacheObject& obj, S& state) {
+    }
+    double value(const CacheObject& obj, State& state, double currentL) {
+        return currentL + 1.0;
+    }
+    template <class S>
+    void afterHit(const CacheObject& obj, S& state) {
+    }
+    template <class S>
+    void onEvict(const CacheObject& obj, const S& state) {
+    }
+};
+
+/*
+  GreedyDualOrder: evicts the object with the smallest GD value
+
+  [implementation via indexed 4-ary heap: O(log n) time for each cache miss,
+  hits update the GD value in place]
 */
-class GreedyDualBase : public Cache
+template <class Value>
+class GreedyDualOrder : public Cache
 {
 protected:
+    // a cached object and its value function state (an empty State takes
+    // no space as a base)
+    struct Entry : public Value::State
+    {
+        CacheObject obj;
+    };
+
     // the GD current value
-    long double _currentL = 0;
-    // ordered multi map of GD values, access object id + size
-    ValueMapType _valueMap;
-    // find objects via unordered_map
-    GdCacheMapType _cacheMap;
+    double _currentL;
+    // cached objects by slot, freed slots are reused
+    std::vector<Entry> _slots;
+    std::vector<uint32_t> _freeSlots;
+    // heap of slots ordered by GD value
+    IndexedHeap _valueHeap;
+    // find objects' slots via flat hash table (or array in dense-id mode)
+    ObjectIndex _cacheMap;
+    Value _value;
 
-    virtual long double ageValue(SimpleRequest* req);
-    virtual void hit(SimpleRequest* req);
+    uint32_t allocSlot(const CacheObject& obj) {
+        uint32_t slot;
+        if (_freeSlots.empty()) {
+            slot = _slots.size();
+            _slots.push_back(Entry());
+        } else {
+            slot = _freeSlots.back();
+            _freeSlots.pop_back();
+        }
+        _slots[slot].obj = obj;
+        return slot;
+    }
+
+    void freeSlot(uint32_t slot) {
+        _freeSlots.push_back(slot);
+    }
+
+    // remove the object of a slot, keeping L
+    void evictSlot(uint32_t slot) {
+        const Entry& entry = _slots[slot];
+        const CacheObject obj = entry.obj;
+        LOG("e", _valueHeap.value(slot), obj.id, obj.size);
+        _value.onEvict(obj, entry);
+        _currentSize -= obj.size;
+        _valueHeap.erase(slot);
+        _cacheMap.erase(obj.id);
+        freeSlot(slot);
+    }
 
 public:
-    GreedyDualBase()
+    GreedyDualOrder()
         : Cache(),
           _currentL(0)
     {
     }
-    virtual ~GreedyDualBase()
+    virtual ~GreedyDualOrder()
     {
     }
 
-    virtual bool lookup(SimpleRequest* req);
-    virtual void admit(SimpleRequest* req);
-    virtual void evict(SimpleRequest* req);
-    virtual void evict();
+    bool setOrderPar(const std::string& parName, const std::string& parValue) {
+        return _value.setPar(parName, parValue);
+    }
+
+    virtual void setDenseIds(uint64_t idCount) {
+        _cacheMap.setDense(idCount);
+    }
+
+    virtual bool lookup(SimpleRequest* req) {
+        CacheObject obj(req);
+        _value.onLookup(obj);
+        const uint32_t slot = _cacheMap.find(obj.id);
+        if (slot == INDEX_NONE) {
+            return false;
+        }
+        Entry& entry = _slots[slot];
+        if (entry.obj.size != obj.size) {
+            // the object changed size: a miss, its stale copy is dropped
+            evictSlot(slot);
+            return false;
+        }
+        // log hit
+        LOG("h", 0, obj.id, obj.size);
+        // update current req's value in place
+        _valueHeap.update(slot, _value.value(obj, entry, _currentL));
+        _value.afterHit(obj, entry);
+        return true;
+    }
+
+    virtual void admit(SimpleRequest* req) {
+        const uint64_t size = req->getSize();
+        // object feasible to store?
+        if (size >= _cacheSize) {
+            LOG("error", _cacheSize, req->getId(), size);
+            return;
+        }
+        // check eviction needed
+        while (_currentSize + size > _cacheSize) {
+            GreedyDualOrder::evict();
+        }
+        // admit new object with new GF value
+        CacheObject obj(req);
+        const uint32_t slot = allocSlot(obj);
+        Entry& entry = _slots[slot];
+        _value.onAdmit(obj, entry);
+        const double ageVal = _value.value(obj, entry, _currentL);
+        LOG("a", ageVal, obj.id, obj.size);
+        _cacheMap.insert(obj.id, slot);
+        _valueHeap.push(slot, ageVal);
+        _currentSize += size;
+    }
+
+    virtual void evict(SimpleRequest* req) {
+        // evict the object with the id of this request
+        const uint32_t slot = _cacheMap.find(req->getId());
+        if (slot != INDEX_NONE) {
+            evictSlot(slot);
+        }
+    }
+
+    virtual void evict() {
+        // evict heap top (smallest value)
+        if (!_valueHeap.empty()) {
+            const uint32_t slot = _valueHeap.top();
+            const Entry& entry = _slots[slot];
+            CacheObject toDelObj = entry.obj;
+            LOG("e", _valueHeap.topValue(), toDelObj.id, toDelObj.size);
+            _value.onEvict(toDelObj, entry);
+            _currentSize -= toDelObj.size;
+            _cacheMap.erase(toDelObj.id);
+            // update L
+            _currentL = _valueHeap.topValue();
+            _valueHeap.pop();
+            freeSlot(slot);
+        }
+    }
 };
 
-static Factory<GreedyDualBase> factoryGD("GD");
+typedef ComposedCache<GreedyDualOrder<GDValue>, AdmitAlways> GDCache;
+
+static Factory<GDCache> factoryGD("GD");
 
 /*
   Greedy Dual Size policy
 */
-class GDSCache : public GreedyDualBase
+struct GDSValue : public GDValue
 {
-protected:
-    virtual long double ageValue(SimpleRequest* req);
-
-public:
-    GDSCache()
-        : GreedyDualBase()
-    {
-    }
-    virtual ~GDSCache()
-    {
+    double value(const CacheObject& obj, State& state, double currentL) {
+        return currentL + 1.0 / static_cast<double>(obj.size);
     }
 };
 
+typedef ComposedCache<GreedyDualOrder<GDSValue>, AdmitAlways> GDSCache;
+
 static Factory<GDSCache> factoryGDS("GDS");
 
 /*
   Greedy Dual Size Frequency policy
+
+  the request count of a cached object lives in its GD entry. by default a
+  readmitted object starts over at one request; with a ghost table of g
+  entries (parameter g) the counts of evicted objects are retained in
+  bounded memory and resumed on readmission.
 */
-class GDSFCache : public GreedyDualBase
+class GDSFValue : public GDValue
 {
 protected:
-    CacheStatsMapType _reqsMap;
-
-    virtual long double ageValue(SimpleRequest* req);
+    GhostTable<uint64_t> _ghosts;
 
 public:
-    GDSFCache()
-        : GreedyDualBase()
+    struct State
     {
+        uint64_t reqs;
+    };
+
+    // g: entries of the ghost table (default 0: no history)
+    bool setPar(const std::string& parName, const std::string& parValue);
+    void onAdmit(const CacheObject& obj, State& state) {
+        state.reqs = 1;
+        uint64_t reqs;
+        if (_ghosts.enabled() && _ghosts.take(obj, reqs)) {
+            state.reqs += reqs;
+        }
     }
-    virtual ~GDSFCache()
-    {
+    double value(const CacheObject& obj, State& state, double currentL) {
+        return currentL + static_cast<double>(state.reqs) / static_cast<double>(obj.size);
+    }
+    void afterHit(const CacheObject& obj, State& state) {
+        state.reqs++;
+    }
+    void onEvict(const CacheObject& obj, const State& state) {
+        if (_ghosts.enabled()) {
+            _ghosts.insert(obj, state.reqs);
+        }
     }
-
-    virtual bool lookup(SimpleRequest* req);
 };
 
+typedef ComposedCache<GreedyDualOrder<GDSFValue>, AdmitAlways> GDSFCache;
+
 static Factory<GDSFCache> factoryGDSF("GDSF");
 
 /*
   LRU-K policy
-*/
-typedef std::unordered_map<CacheObject, std::queue<uint64_t>> lrukMapType;
 
-class LRUKCache : public GreedyDualBase
+  the value of an object is the time of its K-th most recent reference
+  (0 before K references). the reference times of a cached object are
+  kept inline in its GD entry, in a ring of K entries. evicted objects
+  lose their history unless a ghost table of g entries (parameter g)
+  retains it in bounded memory.
+*/
+template <unsigned K>
+class LRUKValue : public GDValue
 {
+public:
+    struct State
+    {
+        uint64_t refs[K];
+        uint32_t start; // oldest reference
+        uint32_t count;
+    };
+
 protected:
-    lrukMapType _refsMap;
-    unsigned int _tk;
+    GhostTable<State> _ghosts;
     uint64_t _curTime;
 
-    virtual long double ageValue(SimpleRequest* req);
-
 public:
-    LRUKCache();
-    virtual ~LRUKCache()
+    LRUKValue()
+        : _curTime(0)
     {
     }
 
-    virtual void setPar(std::string parName, std::string parValue);
-    virtual bool lookup(SimpleRequest* req);
-    virtual void evict(SimpleRequest* req);
-    virtual void evict();
+    // g: entries of the ghost table (default 0: no history)
+    // k: chosen by LRUKFactory
+    bool setPar(const std::string& parName, const std::string& parValue) {
+        if (parName.compare("g") == 0) {
+            _ghosts.resize(std::stoull(parValue));
+            return true;
+        }
+        return parName.compare("k") == 0 && std::stoul(parValue) == K;
+    }
+    void onLookup(const CacheObject& obj) {
+        _curTime++;
+    }
+    void onAdmit(const CacheObject& obj, State& state) {
+        state.start = 0;
+        state.count = 0;
+        if (_ghosts.enabled()) {
+            _ghosts.take(obj, state);
+        }
+    }
+    // records the current reference (value is called once per request)
+    double value(const CacheObject& obj, State& state, double currentL) {
+        state.refs[(state.start + state.count) % K] = _curTime;
+        state.count++;
+        if (state.count < K) {
+            return 0.0;
+        }
+        // K references: the oldest one is the K-th most recent
+        const double newVal = state.refs[state.start];
+        state.start = (state.start + 1) % K;
+        state.count--;
+        return newVal;
+    }
+    void onEvict(const CacheObject& obj, const State& state) {
+        if (_ghosts.enabled()) {
+            _ghosts.insert(obj, state);
+        }
+    }
 };
 
-static Factory<LRUKCache> factoryLRUK("LRUK");
+// largest k with a compiled LRU-K specialization
+const unsigned LRUK_MAX_K = 8;
 
 /*
-  LFUDA
+  LRUK: the factory creates the LRU-K specialization for the k parameter
+  (k=2 by default), so the policy runs as its ComposedCache directly
 */
-class LFUDACache : public GreedyDualBase
+class LRUKFactory : public CacheFactory
 {
-protected:
-    CacheStatsMapType _reqsMap;
+public:
+    LRUKFactory(std::string name) { Cache::registerType(name, this); }
+    std::unique_ptr<Cache> create_unique();
+    // k: eviction based on the k-th reference in the past (1 <= k <= 8)
+    std::unique_ptr<Cache> create_unique_for(const CacheParams& params);
+};
 
-    virtual long double ageValue(SimpleRequest* req);
+static LRUKFactory factoryLRUK("LRUK");
 
+/*
+  LFUDA
+*/
+class LFUDAValue : public GDSFValue
+{
 public:
-    LFUDACache()
-        : GreedyDualBase()
-    {
+    double value(const CacheObject& obj, State& state, double currentL) {
+        return currentL + state.reqs;
     }
-    virtual ~LFUDACache()
-    {
-    }
-
-    virtual bool lookup(SimpleRequest* req);
 };
 
+typedef ComposedCache<GreedyDualOrder<LFUDAValue>, AdmitAlways> LFUDACache;
+
 static Factory<LFUDACache> factoryLFUDA("LFUDA");
 
 #endif /* GD_VARIANTS_H */
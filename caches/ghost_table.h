@@ -0,0 +1,76 @@
+#ifndef GHOST_TABLE_H
+#define GHOST_TABLE_H
+
+#include <cstdint>
+#include <vector>
+#include "cache_object.h"
+
+/*
+  GhostTable: bounded history of objects that left the cache
+
+  a direct-mapped table keyed by the mixed hash of the object. a newer
+  entry replaces an older one in the same bucket, so the memory is fixed
+  by the capacity instead of growing with the trace. capacity 0 disables
+  the table.
+*/
+template <class T>
+class GhostTable
+{
+protected:
+    struct Entry
+    {
+        uint64_t key; // 0: empty
+        T value;
+    };
+
+    std::vector<Entry> _entries;
+    uint64_t _mask;
+
+    static uint64_t key(const CacheObject& obj) {
+        const uint64_t k = mixHash(std::hash<CacheObject>()(obj));
+        return k != 0 ? k : 1;
+    }
+
+public:
+    GhostTable()
+        : _mask(0)
+    {
+    }
+
+    // capacity is rounded up to a power of two, drops all entries
+    void resize(uint64_t capacity) {
+        uint64_t n = capacity > 0 ? 1 : 0;
+        while (n < capacity) {
+            n <<= 1;
+        }
+        Entry empty = Entry();
+        empty.key = 0;
+        _entries.assign(n, empty);
+        _mask = n > 0 ? n - 1 : 0;
+    }
+
+    bool enabled() const {
+        return !_entries.empty();
+    }
+
+    void insert(const CacheObject& obj, const T& value) {
+        const uint64_t k = key(obj);
+        Entry& e = _entries[k & _mask];
+        e.key = k;
+        e.value = value;
+    }
+
+    // remove obj's entry into value, false if obj has none
+    bool take(const CacheObject& obj, T& value) {
+        const uint64_t k = key(obj);
+        Entry& e = _entries[k & _mask];
+        if (e.key != k) {
+            return false;
+        }
+        value = e.value;
+        e.key = 0;
+        return true;
+    }
+};
+
+#endif /* GHOST_TABLE_H */
@@ -0,0 +1,147 @@
+#ifndef INDEXED_HEAP_H
+#define INDEXED_HEAP_H
+
+#include <cstdint>
+#include <vector>
+#include "object_index.h" /* INDEX_NONE */
+
+/*
+  IndexedHeap: 4-ary min-heap of slots ordered by a priority value
+
+  each slot's heap position is tracked, so a slot's priority can be
+  changed in place (no erase + insert). equal priorities are ordered by
+  the time they were set, oldest first (like std::multimap::emplace).
+*/
+class IndexedHeap
+{
+protected:
+    struct Entry
+    {
+        double value;
+        uint64_t seq; // tie breaker
+        uint32_t slot;
+    };
+
+    std::vector<Entry> _heap;
+    std::vector<uint32_t> _pos; // heap position of each slot
+    uint64_t _seq;
+
+    static bool less(const Entry& a, const Entry& b) {
+        return a.value < b.value || (a.value == b.value && a.seq < b.seq);
+    }
+
+    void place(size_t i, const Entry& e) {
+        _heap[i] = e;
+        _pos[e.slot] = i;
+    }
+
+    void siftUp(size_t i) {
+        const Entry e = _heap[i];
+        while (i > 0) {
+            const size_t parent = (i - 1) / 4;
+            if (!less(e, _heap[parent])) {
+                break;
+            }
+            place(i, _heap[parent]);
+            i = parent;
+        }
+        place(i, e);
+    }
+
+    void siftDown(size_t i) {
+        const Entry e = _heap[i];
+        const size_t n = _heap.size();
+        while (true) {
+            const size_t first = 4 * i + 1;
+            if (first >= n) {
+                break;
+            }
+            // smallest child
+            size_t min = first;
+            const size_t last = first + 4 < n ? first + 4 : n;
+            for (size_t c = first + 1; c < last; c++) {
+                if (less(_heap[c], _heap[min])) {
+                    min = c;
+                }
+            }
+            if (!less(_heap[min], e)) {
+                break;
+            }
+            place(i, _heap[min]);
+            i = min;
+        }
+        place(i, e);
+    }
+
+public:
+    IndexedHeap()
+        : _seq(0)
+    {
+    }
+
+    bool empty() const {
+        return _heap.empty();
+    }
+    size_t size() const {
+        return _heap.size();
+    }
+
+    // slot with the smallest priority
+    uint32_t top() const {
+        return _heap[0].slot;
+    }
+    double topValue() const {
+        return _heap[0].value;
+    }
+
+    double value(uint32_t slot) const {
+        return _heap[_pos[slot]].value;
+    }
+
+    bool contains(uint32_t slot) const {
+        return slot < _pos.size() && _pos[slot] != INDEX_NONE;
+    }
+
+    // slot must not be in the heap
+    void push(uint32_t slot, double value) {
+        if (slot >= _pos.size()) {
+            _pos.resize(slot + 1, INDEX_NONE);
+        }
+        Entry e = {value, _seq++, slot};
+        _heap.push_back(e);
+        siftUp(_heap.size() - 1);
+    }
+
+    // set a new priority, the slot counts as most recently set among ties
+    void update(uint32_t slot, double value) {
+        const size_t i = _pos[slot];
+        // a tie moves behind the other equal priorities
+        const bool down = value >= _heap[i].value;
+        _heap[i].value = value;
+        _heap[i].seq = _seq++;
+        if (down) {
+            siftDown(i);
+        } else {
+            siftUp(i);
+        }
+    }
+
+    void erase(uint32_t slot) {
+        const size_t i = _pos[slot];
+        _pos[slot] = INDEX_NONE;
+        const Entry last = _heap.back();
+        _heap.pop_back();
+        if (i < _heap.size()) {
+            _heap[i] = last;
+            _pos[last.slot] = i;
+            siftUp(i);
+            siftDown(_pos[last.slot]);
+        }
+    }
+
+    void pop() {
+        erase(top());
+    }
+};
+
+#endif /* INDEXED_HEAP_H */
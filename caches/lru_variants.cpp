@@ -5,297 +5,313 @@
 #include <cmath>
 #include <cassert>
 #include "lru_variants.h"
+#include "adaptsize_model.h"
 #include "../random_helper.h"
 
 // golden section search helpers
 #define SHFT2(a,b,c) (a)=(b);(b)=(c);
 #define SHFT3(a,b,c,d) (a)=(b);(b)=(c);(c)=(d);
 
-// math model below can be directly copiedx
-// static inline double oP1(double T, double l, double p) {
-static inline double oP1(double T, double l, double p) {
-    return (l * p * T * (840.0 + 60.0 * l * T + 20.0 * l*l * T*T + l*l*l * T*T*T));
-}
-
-static inline double oP2(double T, double l, double p) {
-    return (840.0 + 120.0 * l * (-3.0 + 7.0 * p) * T + 60.0 * l*l * (1.0 + p) * T*T + 4.0 * l*l*l * (-1.0 + 5.0 * p) * T*T*T + l*l*l*l * p * T*T*T*T);
-}
-
 /*
-  LRU: Least Recently Used eviction
+  AdaptSize: ExpLRU with automatic adaption of the _cParam
 */
-bool LRUCache::lookup(SimpleRequest* req)
+AdaptSizeAdmission::AdaptSizeAdmission()
+    : _cParam(1 << 15)
+    , statSize(0)
+    , _maxIterations(15)
+    , _reconfiguration_interval(500000)
+    , _nextReconfiguration(_reconfiguration_interval)
+    , _modelPool(new ModelPool(1))
+    , _currentInterval(0)
+    , _async(false)
+    , _queuedInterval(NO_INTERVAL)
+    , _workerInterval(NO_INTERVAL)
+    , _workerStop(false)
+    , _workerCacheSize(0)
+    , _mergedIntervals(0)
+    , _droppedIntervals(0)
+    , _searches(0)
+    , _histogramMode(0)
 {
-    // CacheObject: defined in cache_object.h 
-    CacheObject obj(req);
-    // _cacheMap defined in class LRUCache in lru_variants.h 
-    auto it = _cacheMap.find(obj);
-    if (it != _cacheMap.end()) {
-        // log hit
-        LOG("h", 0, obj.id, obj.size);
-        hit(it, obj.size);
-        return true;
-    }
-    return false;
+    _gss_v=1.0-gss_r; // golden section search book parameters
 }
 
-void LRUCache::admit(SimpleRequest* req)
+AdaptSizeAdmission::~AdaptSizeAdmission()
 {
-    const uint64_t size = req->getSize();
-    // object feasible to store?
-    if (size > _cacheSize) {
-        LOG("L", _cacheSize, req->getId(), size);
-        return;
-    }
-    // check eviction needed
-    while (_currentSize + size > _cacheSize) {
-        evict();
+    if(_worker.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(_workerMutex);
+            _workerStop = true;
+        }
+        _workerCv.notify_one();
+        _worker.join();
+        // a background thread that merged intervals but never searched
+        // would leave _cParam at its initial value
+        std::cerr << "Async reconfiguration: " << _mergedIntervals << " intervals merged, "
+                  << _droppedIntervals << " dropped, " << _searches << " parameter searches"
+                  << std::endl;
     }
-    // admit new object
-    CacheObject obj(req);
-    _cacheList.push_front(obj);
-    _cacheMap[obj] = _cacheList.begin();
-    _currentSize += size;
-    LOG("a", _currentSize, obj.id, obj.size);
 }
 
-void LRUCache::evict(SimpleRequest* req)
-{
-    CacheObject obj(req);
-    auto it = _cacheMap.find(obj);
-    if (it != _cacheMap.end()) {
-        ListIteratorType lit = it->second;
-        LOG("e", _currentSize, obj.id, obj.size);
-        _currentSize -= obj.size;
-        _cacheMap.erase(obj);
-        _cacheList.erase(lit);
+bool AdaptSizeAdmission::setPar(const std::string& parName, const std::string& parValue) {
+    if(parName.compare("t") == 0) {
+        const uint64_t t = stoull(parValue);
+        assert(t>1);
+        _reconfiguration_interval = t;
+        return true;
+    } else if(parName.compare("i") == 0) {
+        const uint64_t i = stoull(parValue);
+        assert(i>1);
+        _maxIterations = i;
+        return true;
+    } else if(parName.compare("p") == 0) {
+        const unsigned p = stoul(parValue);
+        assert(p>0);
+        _modelPool.reset(new ModelPool(p));
+        return true;
+    } else if(parName.compare("a") == 0) {
+        _async = stoul(parValue) != 0;
+        for(unsigned i=1; i<3; i++) {
+            _intervals[i].dense.assign(_async ? _intervals[0].dense.size() : 0, ObjInfo());
+        }
+        return true;
+    } else if(parName.compare("h") == 0) {
+        const unsigned h = stoul(parValue);
+        assert(h<=2);
+        _histogramMode = h;
+        _denseLongTerm.assign(h != 1 ? _intervals[0].dense.size() : 0, ObjInfo());
+        return true;
     }
+    return false;
 }
 
-SimpleRequest* LRUCache::evict_return()
-{
-    // evict least popular (i.e. last element)
-    if (_cacheList.size() > 0) {
-        ListIteratorType lit = _cacheList.end();
-        lit--;
-        CacheObject obj = *lit;
-        LOG("e", _currentSize, obj.id, obj.size);
-        SimpleRequest* req = new SimpleRequest(obj.id, obj.size);
-        _currentSize -= obj.size;
-        _cacheMap.erase(obj);
-        _cacheList.erase(lit);
-        return req;
-    }
-    return NULL;
-}
-
-void LRUCache::evict()
-{
-    evict_return();
-}
-
-// const_iterator: a forward iterator to const value_type, where 
-// value_type is pair<const key_type, mapped_type>
-void LRUCache::hit(lruCacheMapType::const_iterator it, uint64_t size)
-{
-    // transfers it->second (i.e., ObjInfo) from _cacheList into 
-    // 	*this. The transferred it->second is to be inserted before 
-    // 	the element pointed to by _cacheList.begin()
-    //
-    // _cacheList is defined in class LRUCache in lru_variants.h 
-    _cacheList.splice(_cacheList.begin(), _cacheList, it->second);
-}
-
-/*
-  FIFO: First-In First-Out eviction
-*/
-void FIFOCache::hit(lruCacheMapType::const_iterator it, uint64_t size)
-{
+void AdaptSizeAdmission::setDenseIds(uint64_t idCount) {
+    // histogram-only mode keeps no per-object long-term stats
+    _denseLongTerm.assign(_histogramMode != 1 ? idCount : 0, ObjInfo());
+    _intervals[0].dense.assign(idCount, ObjInfo());
+    for(unsigned i=1; i<3; i++) {
+        _intervals[i].dense.assign(_async ? idCount : 0, ObjInfo());
+    }
 }
 
-/*
-  FilterCache (admit only after N requests)
-*/
-FilterCache::FilterCache()
-    : LRUCache(),
-      _nParam(2)
+void AdaptSizeAdmission::onLookup(SimpleRequest* req, const Cache& cache)
 {
-}
+    reconfigure(cache); 
 
-void FilterCache::setPar(std::string parName, std::string parValue) {
-    if(parName.compare("n") == 0) {
-        const uint64_t n = std::stoull(parValue);
-        assert(n>0);
-        _nParam = n;
-    } else {
-        std::cerr << "unrecognized parameter: " << parName << std::endl;
+    // in async mode the long-term stats belong to the background thread,
+    // which accounts new objects and size changes in statSize when merging
+    IntervalStats& interval = _intervals[_currentInterval];
+    const IdType id = req->getId();
+    const uint64_t size = req->getSize();
+    if(id < interval.dense.size()) {
+        // dense-id mode, no hashing
+        ObjInfo& info = interval.dense[id];
+        if(info.requestCount == 0) {
+            if(!_async) {
+                if(_denseLongTerm.empty() || _denseLongTerm[id].requestCount == 0) {
+                    // new object
+                    statSize += size;
+                } else {
+                    resizeStat(_denseLongTerm[id].objSize, size);
+                }
+            }
+            interval.ids.push_back(id);
+        } else if(!_async) {
+            resizeStat(info.objSize, size);
+        }
+        info.requestCount += 1.0;
+        info.objSize = size;
+        return;
     }
-}
 
+    // objects are keyed by id, a size change updates the stats in place
+    CacheObject tmpCacheObject0(req);
+    auto& info = interval.metadata[tmpCacheObject0];
+    if(!_async) {
+        if(info.requestCount > 0) {
+            resizeStat(info.objSize, size);
+        } else {
+            auto longTermIt = _longTermMetadata.find(tmpCacheObject0);
+            if(longTermIt == _longTermMetadata.end()) {
+                // new object
+                statSize += size;
+            } else {
+                resizeStat(longTermIt->second.objSize, size);
+            }
+        }
+    }
 
-bool FilterCache::lookup(SimpleRequest* req)
-{
-    CacheObject obj(req);
-    _filter[obj]++;
-    return LRUCache::lookup(req);
+    // record stats
+    info.requestCount += 1.0;
+    info.objSize = size;
 }
 
-void FilterCache::admit(SimpleRequest* req)
+bool AdaptSizeAdmission::admit(SimpleRequest* req, const Cache& cache)
 {
-    CacheObject obj(req);
-    if (_filter[obj] <= _nParam) {
-        return;
+    const double c = _cParam.load(std::memory_order_relaxed);
+    if(c != _admissionTable.c()) {
+        _admissionTable.build(c);
     }
-    LRUCache::admit(req);
+    return _random() < _admissionTable.threshold(req->getSize());
 }
 
+void AdaptSizeAdmission::reconfigure(const Cache& cache) {
+    --_nextReconfiguration;
+    if (_nextReconfiguration > 0) {
+        return;
+    } else if (_async) {
+        handOff(cache.getSize());
+        return;
+    } else if(statSize <= cache.getSize()*3) {
+        // not enough data has been gathered
+        _nextReconfiguration+=10000;
+        return; 
+    } else {
+        _nextReconfiguration = _reconfiguration_interval;
+    }
 
-/*
-  ThLRU: LRU eviction with a size admission threshold
-*/
-ThLRUCache::ThLRUCache()
-    : LRUCache(),
-      _sizeThreshold(524288)
-{
+    updateStats(_intervals[0]);
+    chooseParameter(cache.getSize());
 }
 
-void ThLRUCache::setPar(std::string parName, std::string parValue) {
-    if(parName.compare("t") == 0) {
-        const double t = stof(parValue);
-        assert(t>0);
-        _sizeThreshold = pow(2.0,t);
-    } else {
-        std::cerr << "unrecognized parameter: " << parName << std::endl;
+void AdaptSizeAdmission::handOff(uint64_t cacheSize) {
+    // the next interval has the same length, whether or not this one is
+    // merged
+    _nextReconfiguration = _reconfiguration_interval;
+    {
+        std::lock_guard<std::mutex> lock(_workerMutex);
+        if(!_worker.joinable()) {
+            _worker = std::thread(&AdaptSizeAdmission::reconfigureWorker, this);
+        }
+        _workerCacheSize = cacheSize;
+        if(_queuedInterval == NO_INTERVAL) {
+            // queue the finished interval, record into a free buffer
+            _queuedInterval = _currentInterval;
+            for(unsigned i=0; i<3; i++) {
+                if(i != _queuedInterval && i != _workerInterval) {
+                    _currentInterval = i;
+                    break;
+                }
+            }
+            _workerCv.notify_one();
+            return;
+        }
     }
+    // the background thread is more than an interval behind
+    std::cerr << "Dropping an interval, reconfiguration is busy" << std::endl;
+    _droppedIntervals++;
+    clearInterval(_intervals[_currentInterval]);
 }
 
-
-void ThLRUCache::admit(SimpleRequest* req)
-{
-    const uint64_t size = req->getSize();
-    // admit if size < threshold
-    if (size < _sizeThreshold) {
-        LRUCache::admit(req);
+void AdaptSizeAdmission::reconfigureWorker() {
+    std::unique_lock<std::mutex> lock(_workerMutex);
+    while(true) {
+        _workerCv.wait(lock, [this] { return _queuedInterval != NO_INTERVAL || _workerStop; });
+        if(_workerStop) {
+            return;
+        }
+        _workerInterval = _queuedInterval;
+        _queuedInterval = NO_INTERVAL;
+        IntervalStats& interval = _intervals[_workerInterval];
+        const uint64_t cacheSize = _workerCacheSize;
+        lock.unlock();
+        // updateStats empties the interval, so its buffer is free afterwards
+        updateStats(interval);
+        lock.lock();
+        _workerInterval = NO_INTERVAL;
+        _mergedIntervals++;
+        if(statSize <= cacheSize*3) {
+            // not enough data has been gathered
+            continue;
+        }
+        // search after every merge, even if the next interval is already
+        // queued, so a busy thread can't postpone the search indefinitely
+        lock.unlock();
+        chooseParameter(cacheSize);
+        lock.lock();
+        _searches++;
     }
 }
 
+void AdaptSizeAdmission::ModelArrays::clear() {
+    reqCount.clear();
+    objSize.clear();
+    weight.clear();
+    totalReqCount = 0.0;
+}
 
-/*
-  ExpLRU: LRU eviction with size-aware probabilistic cache admission
-*/
-ExpLRUCache::ExpLRUCache()
-    : LRUCache(),
-      _cParam(262144)
-{
+void AdaptSizeAdmission::ModelArrays::push(double rate, double size, double w) {
+    reqCount.push_back(rate);
+    objSize.push_back(size);
+    weight.push_back(w);
+    totalReqCount += w * rate;
 }
 
-void ExpLRUCache::setPar(std::string parName, std::string parValue) {
-    if(parName.compare("c") == 0) {
-        const double c = stof(parValue);
-        assert(c>0);
-        _cParam = pow(2.0,c);
-    } else {
-        std::cerr << "unrecognized parameter: " << parName << std::endl;
+void AdaptSizeAdmission::ModelArrays::pad() {
+    while(reqCount.size() % MODEL_PADDING != 0) {
+        reqCount.push_back(0.0);
+        objSize.push_back(0.0);
+        weight.push_back(0.0);
     }
+    admProb.resize(reqCount.size());
 }
 
-
-
-void ExpLRUCache::admit(SimpleRequest* req)
-{
-    const double size = req->getSize();
-    // admit to cache with probablity that is exponentially decreasing with size
-    double admissionProb = exp(-size/ _cParam);
-    std::bernoulli_distribution distribution(admissionProb);
-    if (distribution(globalGenerator)) {
-        LRUCache::admit(req);
+void AdaptSizeAdmission::updateStats(IntervalStats& interval) {
+    // the histogram goes first, mergeInterval empties the interval
+    if(_histogramMode != 0) {
+        mergeHistogram(interval);
+    }
+    if(_histogramMode != 1) {
+        mergeInterval(interval);
+        return;
     }
+    clearInterval(interval);
 }
 
-
-AdaptSizeCache::AdaptSizeCache()
-    : LRUCache()
-    , _cParam(1 << 15)
-    , statSize(0)
-    , _maxIterations(15)
-    , _reconfiguration_interval(500000)
-    , _nextReconfiguration(_reconfiguration_interval)
-{
-    _gss_v=1.0-gss_r; // golden section search book parameters
+void AdaptSizeAdmission::clearInterval(IntervalStats& interval) {
+    interval.metadata.clear();
+    for(const IdType id : interval.ids) {
+        interval.dense[id] = ObjInfo();
+    }
+    interval.ids.clear();
 }
 
-void AdaptSizeCache::setPar(std::string parName, std::string parValue) {
-    if(parName.compare("t") == 0) {
-        const uint64_t t = stoull(parValue);
-        assert(t>1);
-        _reconfiguration_interval = t;
-    } else if(parName.compare("i") == 0) {
-        const uint64_t i = stoull(parValue);
-        assert(i>1);
-        _maxIterations = i;
+void AdaptSizeAdmission::mergeHistogram(IntervalStats& interval) {
+    _intervalHistogram.clear();
+    for(const auto& it : interval.metadata) {
+        _intervalHistogram.add(it.second.requestCount, it.second.objSize);
+    }
+    for(const IdType id : interval.ids) {
+        const ObjInfo& info = interval.dense[id];
+        _intervalHistogram.add(info.requestCount, info.objSize);
+    }
+    // the long-term histogram is an EWMA of the interval histograms
+    if(_longTermHistogram.empty()) {
+        _longTermHistogram.blend(0.0, _intervalHistogram, 1.0);
     } else {
-        std::cerr << "unrecognized parameter: " << parName << std::endl;
+        _longTermHistogram.blend(EWMA_DECAY, _intervalHistogram, 1. - EWMA_DECAY);
     }
-}
+    _longTermHistogram.prune(0.1);
 
-bool AdaptSizeCache::lookup(SimpleRequest* req)
-{
-    reconfigure(); 
-
-    CacheObject tmpCacheObject0(req); 
-    if(_intervalMetadata.count(tmpCacheObject0)==0 
-       && _longTermMetadata.count(tmpCacheObject0)==0) { 
-        // new object 
-        statSize += tmpCacheObject0.size;
-    }
-    // the else block is not necessary as webcachesim treats an object 
-    // with size changed as a new object 
-    /** 
-	} else {
-        // keep track of changing object sizes
-        if(_intervalMetadata.count(id)>0 
-        && _intervalMetadata[id].size != req.size()) {
-        // outdated size info in _intervalMetadata
-        statSize -= _intervalMetadata[id].size;
-        statSize += req.size();
-        }
-        if(_longTermMetadata.count(id)>0 && _longTermMetadata[id].size != req.size()) {
-        // outdated size info in ewma
-        statSize -= _longTermMetadata[id].size;
-        statSize += req.size();
+    // one model element per bin, at the bin's mean rate and size
+    _histModel.clear();
+    for(const auto& bin : _longTermHistogram.bins()) {
+        if(bin.weight > 0) {
+            _histModel.push(bin.rateSum / bin.weight, bin.sizeSum / bin.weight, bin.weight);
         }
-	}
-    */
-
-    // record stats
-    auto& info = _intervalMetadata[tmpCacheObject0]; 
-    info.requestCount += 1.0;
-    info.objSize = tmpCacheObject0.size;
-
-    return LRUCache::lookup(req);
-}
-
-void AdaptSizeCache::admit(SimpleRequest* req)
-{
-    double roll = _uniform_real_distribution(globalGenerator);
-    double admitProb = std::exp(-1.0 * double(req->getSize())/_cParam); 
+    }
+    const double totalObjSize = _longTermHistogram.totalSize();
+    _histModel.pad();
+    if(_histogramMode == 1) {
+        statSize = uint64_t(totalObjSize);
+    }
 
-    if(roll < admitProb) 
-        LRUCache::admit(req); 
+    std::cerr << "Reconfiguring over " << _histModel.reqCount.size() 
+              << " histogram bins - log2 total size " << std::log2(totalObjSize) 
+              << " log2 statsize " << std::log2(statSize) << std::endl; 
 }
 
-void AdaptSizeCache::reconfigure() {
-    --_nextReconfiguration;
-    if (_nextReconfiguration > 0) {
-        return;
-    } else if(statSize <= getSize()*3) {
-        // not enough data has been gathered
-        _nextReconfiguration+=10000;
-        return; 
-    } else {
-        _nextReconfiguration = _reconfiguration_interval;
-    }
-
+void AdaptSizeAdmission::mergeInterval(IntervalStats& interval) {
     // smooth stats for objects 
     for(auto it = _longTermMetadata.begin(); 
         it != _longTermMetadata.end(); 
@@ -304,25 +320,53 @@ void AdaptSizeCache::reconfigure() {
     } 
 
     // persist intervalinfo in _longTermMetadata 
-    for (auto it = _intervalMetadata.begin(); 
-         it != _intervalMetadata.end();
+    for (auto it = interval.metadata.begin(); 
+         it != interval.metadata.end();
          it++) {
         auto ewmaIt = _longTermMetadata.find(it->first); 
         if(ewmaIt != _longTermMetadata.end()) {
             ewmaIt->second.requestCount += (1. - EWMA_DECAY) 
                 * it->second.requestCount;
+            if(_async) {
+                resizeStat(ewmaIt->second.objSize, it->second.objSize);
+            }
             ewmaIt->second.objSize = it->second.objSize; 
         } else {
+            if(_async) {
+                statSize += it->second.objSize;
+            }
             _longTermMetadata.insert(*it);
         }
     }
-    _intervalMetadata.clear(); 
+    interval.metadata.clear(); 
+
+    // the same for the dense-id arrays
+    for(const IdType id : _longTermIds) {
+        _denseLongTerm[id].requestCount *= EWMA_DECAY;
+    }
+    for(const IdType id : interval.ids) {
+        ObjInfo& info = interval.dense[id];
+        ObjInfo& longTerm = _denseLongTerm[id];
+        if(longTerm.requestCount > 0) {
+            longTerm.requestCount += (1. - EWMA_DECAY) * info.requestCount;
+            if(_async) {
+                resizeStat(longTerm.objSize, info.objSize);
+            }
+            longTerm.objSize = info.objSize;
+        } else {
+            if(_async) {
+                statSize += info.objSize;
+            }
+            longTerm = info;
+            _longTermIds.push_back(id);
+        }
+        info = ObjInfo();
+    }
+    interval.ids.clear();
 
     // copy stats into vector for better alignment 
     // and delete small values 
-    _alignedReqCount.clear(); 
-    _alignedObjSize.clear();
-    double totalReqCount = 0.0; 
+    _exactModel.clear();
     uint64_t totalObjSize = 0.0; 
     for(auto it = _longTermMetadata.begin(); 
         it != _longTermMetadata.end(); 
@@ -332,18 +376,57 @@ void AdaptSizeCache::reconfigure() {
             statSize -= it->second.objSize; 
             it = _longTermMetadata.erase(it); 
         } else {
-            _alignedReqCount.push_back(it->second.requestCount); 
-            totalReqCount += it->second.requestCount; 
-            _alignedObjSize.push_back(it->second.objSize); 
+            _exactModel.push(it->second.requestCount, it->second.objSize, 1.0);
             totalObjSize += it->second.objSize; 
             ++it;
         }
     }
+    size_t kept = 0;
+    for(const IdType id : _longTermIds) {
+        ObjInfo& info = _denseLongTerm[id];
+        if(info.requestCount < 0.1) {
+            statSize -= info.objSize;
+            info = ObjInfo();
+        } else {
+            _exactModel.push(info.requestCount, info.objSize, 1.0);
+            totalObjSize += info.objSize;
+            _longTermIds[kept++] = id;
+        }
+    }
+    _longTermIds.resize(kept);
+    _exactModel.pad();
 
-    std::cerr << "Reconfiguring over " << _longTermMetadata.size() 
+    std::cerr << "Reconfiguring over " << _longTermMetadata.size() + _longTermIds.size() 
               << " objects - log2 total size " << std::log2(totalObjSize) 
               << " log2 statsize " << std::log2(statSize) << std::endl; 
+}
+
+void AdaptSizeAdmission::chooseParameter(uint64_t cacheSize) {
+    ModelArrays& model = _histogramMode != 0 ? _histModel : _exactModel;
+    double log2c;
+    if(!searchParameter(model, cacheSize, log2c)) {
+        return;
+    }
+    _cParam = pow(2, log2c);
+    std::cerr << "Choosing c of " << _cParam.load() << " (log2: " << log2c << ")" 
+              << std::endl;
+
+    if(_histogramMode == 2 && _exactModel.totalReqCount > 0) {
+        // compare both choices on the exact model
+        double exactLog2c;
+        if(searchParameter(_exactModel, cacheSize, exactLog2c)) {
+            const double histHitRatio = modelHitRate(_exactModel, log2c, cacheSize)
+                / _exactModel.totalReqCount;
+            const double exactHitRatio = modelHitRate(_exactModel, exactLog2c, cacheSize)
+                / _exactModel.totalReqCount;
+            std::cerr << "Histogram model error: log2 c " << log2c << " vs exact " << exactLog2c
+                      << ", modeled OHR " << histHitRatio << " vs " << exactHitRatio
+                      << " (delta " << exactHitRatio - histHitRatio << ")" << std::endl;
+        }
+    }
+}
 
+bool AdaptSizeAdmission::searchParameter(ModelArrays& model, uint64_t cacheSize, double& log2c) {
     // assert(totalObjSize==statSize); 
     //
     // if(totalObjSize > cacheSize*2) {
@@ -353,15 +436,18 @@ void AdaptSizeCache::reconfigure() {
     // x1 and x2 bracket our current estimate of the optimal parameter range
     // |x0 -- x1 -- x2 -- x3|
     double x0 = 0; 
-    double x1 = std::log2(getSize());
+    double x1 = std::log2(cacheSize);
     double x2 = x1;
     double x3 = x1; 
 
     double bestHitRate = 0.0; 
     // course_granular grid search 
     for(int i=2; i<x3; i+=4) {
+        if(_workerStop) {
+            return false;
+        }
         const double next_log2c = i; // 1.0 * (i+1) / NUM_PARAMETER_POINTS;
-        const double hitRate = modelHitRate(next_log2c); 
+        const double hitRate = modelHitRate(model, next_log2c, cacheSize); 
         // printf("Model param (%f) : ohr (%f)\n",
         // 	next_log2c,hitRate/totalReqRate);
 
@@ -377,13 +463,13 @@ void AdaptSizeCache::reconfigure() {
     if(x3-x1 > x1-x0) {
         // above x1 is larger segment 
         x2 = x1+_gss_v*(x3-x1); 
-        h2 = modelHitRate(x2);
+        h2 = modelHitRate(model, x2, cacheSize);
     } else {
         // below x1 is larger segment 
         x2 = x1; 
         h2 = h1; 
         x1 = x0+_gss_v*(x1-x0); 
-        h1 = modelHitRate(x1); 
+        h1 = modelHitRate(model, x1, cacheSize); 
     }
     assert(x1<x2); 
 
@@ -394,16 +480,19 @@ void AdaptSizeCache::reconfigure() {
         //NAN check 
         if((h1!=h1) || (h2!=h2)) 
             break; 
+        if(_workerStop) {
+            return false;
+        }
         // printf("Model param low (%f) : ohr low (%f) | param high (%f) 
         // 	: ohr high (    %f)\n",x1,h1/totalReqRate,x2,
         // 	h2/totalReqRate);
 
         if(h2>h1) {
             SHFT3(x0,x1,x2,gss_r*x1+_gss_v*x3); 
-            SHFT2(h1,h2,modelHitRate(x2));
+            SHFT2(h1,h2,modelHitRate(model, x2, cacheSize));
         } else {
             SHFT3(x3,x2,x1,gss_r*x2+_gss_v*x0);
-            SHFT2(h2,h1,modelHitRate(x1));
+            SHFT2(h2,h1,modelHitRate(model, x1, cacheSize));
         }
     }
 
@@ -412,143 +501,114 @@ void AdaptSizeCache::reconfigure() {
         // numerical failure
         std::cerr << "ERROR: numerical bug " << h1 << " " << h2 
                   << std::endl;
-        // nop
-    } else if (h1 > h2) {
-        // x1 should is final parameter
-        _cParam = pow(2, x1);
-        std::cerr << "Choosing c of " << _cParam << " (log2: " << x1 << ")" 
-                  << std::endl;
-    } else {
-        _cParam = pow(2, x2);
-        std::cerr << "Choosing c of " << _cParam << " (log2: " << x2 << ")" 
-                  << std::endl;
+        return false;
     }
+    // x1 should is final parameter if h1 > h2
+    log2c = h1 > h2 ? x1 : x2;
+    return true;
 }
 
-double AdaptSizeCache::modelHitRate(double log2c) {
+double AdaptSizeAdmission::modelHitRate(ModelArrays& model, double log2c, uint64_t cacheSize) {
     // this code is adapted from the AdaptSize git repo
     // github.com/dasebe/AdaptSize
+    // the passes over the objects run in the kernels of adaptsize_model.h
+    const AdaptSizeKernels& kernels = modelKernels();
+    const double* reqCount = model.reqCount.data();
+    const double* objSize = model.objSize.data();
+    const double* weight = model.weight.data();
+    double* admProb = model.admProb.data();
+    const size_t n = model.reqCount.size();
     double old_T, the_T, the_C;
-    double sum_val = 0.;
-    double thparam = log2c;
+    const double c = pow(2.0, log2c);
 
-    for(size_t i=0; i<_alignedReqCount.size(); i++) {
-        sum_val += _alignedReqCount[i] * (exp(-_alignedObjSize[i]/ pow(2,thparam))) * _alignedObjSize[i];
-    }
+    // prepare admission probabilities
+    const double sum_val = _modelPool->sum(n, [&](size_t begin, size_t end) {
+            return kernels.admission(reqCount, objSize, weight, admProb, begin, end, c);
+        });
     if(sum_val <= 0) {
         return(0);
     }
-    the_T = getSize() / sum_val;
-    // prepare admission probabilities
-    _alignedAdmProb.clear();
-    for(size_t i=0; i<_alignedReqCount.size(); i++) {
-        _alignedAdmProb.push_back(exp(-_alignedObjSize[i]/ pow(2.0,thparam)));
-    }
+    the_T = cacheSize / sum_val;
     // 20 iterations to calculate TTL
   
     for(int j = 0; j<10; j++) {
-        the_C = 0;
         if(the_T > 1e70) {
             break;
         }
-        for(size_t i=0; i<_alignedReqCount.size(); i++) {
-            const double reqTProd = _alignedReqCount[i]*the_T;
-            if(reqTProd>150) {
-                // cache hit probability = 1, but numerically inaccurate to calculate
-                the_C += _alignedObjSize[i];
-            } else {
-                const double expTerm = exp(reqTProd) - 1;
-                const double expAdmProd = _alignedAdmProb[i] * expTerm;
-                const double tmp = expAdmProd / (1 + expAdmProd);
-                the_C += _alignedObjSize[i] * tmp;
-            }
-        }
+        const double T = the_T;
+        the_C = _modelPool->sum(n, [&](size_t begin, size_t end) {
+                return kernels.occupancy(reqCount, objSize, weight, admProb, begin, end, T);
+            });
         old_T = the_T;
-        the_T = getSize() * old_T/the_C;
+        the_T = cacheSize * old_T/the_C;
     }
 
     // calculate object hit ratio
-    double weighted_hitratio_sum = 0;
-    for(size_t i=0; i<_alignedReqCount.size(); i++) {
-        const double tmp01= oP1(the_T,_alignedReqCount[i],_alignedAdmProb[i]);
-        const double tmp02= oP2(the_T,_alignedReqCount[i],_alignedAdmProb[i]);
-        double tmp;
-        if(tmp01!=0 && tmp02==0)
-            tmp = 0.0;
-        else tmp= tmp01/tmp02;
-        if(tmp<0.0)
-            tmp = 0.0;
-        else if (tmp>1.0)
-            tmp = 1.0;
-        weighted_hitratio_sum += _alignedReqCount[i] * tmp;
-    }
-    return (weighted_hitratio_sum);
+    const double T = the_T;
+    return _modelPool->sum(n, [&](size_t begin, size_t end) {
+            return kernels.hitRatio(reqCount, weight, admProb, begin, end, T);
+        });
 }
 
 /*
-  S4LRU
+  SnLRU
 */
-
-void S4LRUCache::setSize(uint64_t cs) {
-    uint64_t total = cs;
-    for(int i=0; i<4; i++) {
-        segments[i].setSize(cs/4);
-        total -= cs/4;
-        std::cerr << "setsize " << i << " : " << cs/4 << "\n";
-    }
-    if(total>0) {
-        segments[0].setSize(cs/4+total);
-        std::cerr << "bonus setsize " << 0 << " : " << cs/4 + total << "\n";
-    }
+SegmentedLRUOrder::SegmentedLRUOrder()
+    : Cache(),
+      _segmentLists(4),
+      _segmentSize(4, 0),
+      _segmentCurrentSize(4, 0)
+{
 }
 
-bool S4LRUCache::lookup(SimpleRequest* req)
-{
-    for(int i=0; i<4; i++) {
-        if(segments[i].lookup(req)) {
-            // hit
-            if(i<3) {
-                // move up
-                segments[i].evict(req);
-                segment_admit(i+1,req);
-            }
-            return true;
-        }
+bool SegmentedLRUOrder::setOrderPar(const std::string& parName, const std::string& parValue) {
+    if(parName.compare("n") == 0) {
+        const uint32_t n = stoul(parValue);
+        assert(n>0 && _cacheMap.size()==0);
+        _segmentLists = SlabList<SegmentObject>(n);
+        _segmentSize.assign(n, 0);
+        _segmentCurrentSize.assign(n, 0);
+        resizeSegments();
+        return true;
     }
     return false;
 }
 
-void S4LRUCache::admit(SimpleRequest* req)
-{
-    segments[0].admit(req);
+void SegmentedLRUOrder::setSize(uint64_t cs) {
+    _cacheSize = cs;
+    resizeSegments();
 }
 
-void S4LRUCache::segment_admit(uint8_t idx, SimpleRequest* req)
-{
-    if(idx==0) {
-        segments[idx].admit(req);
-    } else {
-        while(segments[idx].getCurrentSize() + req->getSize()
-              > segments[idx].getSize()) {
-            // need to evict from this partition first
-            // find least popular item in this segment
-            auto nreq = segments[idx].evict_return();
-            segment_admit(idx-1,nreq);
+void SegmentedLRUOrder::resizeSegments() {
+    // every segment gets an equal share, segment 0 also gets the remainder
+    const uint64_t n = _segmentSize.size();
+    for(uint64_t i=0; i<n; i++) {
+        _segmentSize[i] = _cacheSize/n;
+    }
+    _segmentSize[0] += _cacheSize%n;
+    // shrinking segments evict from their back
+    for(uint64_t i=0; i<n; i++) {
+        while(_segmentCurrentSize[i] > _segmentSize[i]) {
+            evictNode(_segmentLists.back(i));
         }
-        segments[idx].admit(req);
     }
 }
 
-void S4LRUCache::evict(SimpleRequest* req)
+void SegmentedLRUOrder::segmentAdmit(uint32_t segment, uint32_t node)
 {
-    for(int i=0; i<4; i++) {
-        segments[i].evict(req);
+    const uint64_t size = _segmentLists[node].obj.size;
+    while(_segmentCurrentSize[segment] + size > _segmentSize[segment]) {
+        if(segment == 0) {
+            evict();
+        } else {
+            // demote the least popular object of this segment
+            const uint32_t victim = _segmentLists.back(segment);
+            _segmentLists.unlink(victim, segment);
+            _segmentCurrentSize[segment] -= _segmentLists[victim].obj.size;
+            segmentAdmit(segment - 1, victim);
+        }
     }
+    _segmentLists[node].segment = segment;
+    _segmentLists.linkFront(node, segment);
+    _segmentCurrentSize[segment] += size;
 }
-
-void S4LRUCache::evict()
-{
-    segments[0].evict();
-}
-
-
@@ -2,155 +2,215 @@
 #define LRU_VARIANTS_H
 
 #include <unordered_map>
-#include <list>
 #include <random>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
 #include "cache.h"
 #include "cache_object.h"
+#include "object_index.h"
+#include "slab_list.h"
+#include "admission.h"
+#include "composed_cache.h"
 #include "adaptsize_const.h" /* AdaptSize constants */
+#include "rate_size_histogram.h"
+#include "adaptsize_model.h"
 
+// how a hit reorders the list of a ListCache
+struct MoveToFront
+{
+    static void hit(SlabList<CacheObject>& list, uint32_t node) {
+        list.moveToFront(node);
+    }
+};
 
-typedef std::list<CacheObject>::iterator ListIteratorType;
-typedef std::unordered_map<CacheObject, ListIteratorType> lruCacheMapType;
+struct KeepPosition
+{
+    static void hit(SlabList<CacheObject>& list, uint32_t node) {
+    }
+};
 
 /*
-  LRU: Least Recently Used eviction
+  ListCache: evicts from the back of a list, new objects enter at the front
+
+  the eviction order of LRU (hits move to the front) and FIFO (hits keep
+  their position)
 */
-class LRUCache : public Cache
+template <class HitUpdate>
+class ListCache : public Cache
 {
 protected:
-    // list for recency order
-    // std::list is a container, usually, implemented as a doubly-linked list 
-    std::list<CacheObject> _cacheList;
-    // map to find objects in list
-    lruCacheMapType _cacheMap;
-
-    virtual void hit(lruCacheMapType::const_iterator it, uint64_t size);
+    // list in eviction order (evicted from the back)
+    // nodes are kept in a slab and reused, no allocation per request
+    SlabList<CacheObject> _cacheList;
+    // flat hash table (or array in dense-id mode) to find objects' list nodes
+    ObjectIndex _cacheMap;
+
+    // remove the object of a list node
+    void evictNode(uint32_t node) {
+        // CacheObject: defined in cache_object.h
+        const CacheObject obj = _cacheList[node];
+        LOG("e", _currentSize, obj.id, obj.size);
+        _currentSize -= obj.size;
+        _cacheMap.erase(obj.id);
+        _cacheList.erase(node);
+    }
 
 public:
-    LRUCache()
+    ListCache()
         : Cache()
     {
     }
-    virtual ~LRUCache()
+    virtual ~ListCache()
     {
     }
 
-    virtual bool lookup(SimpleRequest* req);
-    virtual void admit(SimpleRequest* req);
-    virtual void evict(SimpleRequest* req);
-    virtual void evict();
-    virtual SimpleRequest* evict_return();
+    bool setOrderPar(const std::string& parName, const std::string& parValue) {
+        return false;
+    }
+
+    virtual void setDenseIds(uint64_t idCount) {
+        _cacheMap.setDense(idCount);
+    }
+
+    virtual bool lookup(SimpleRequest* req) {
+        const uint32_t node = _cacheMap.find(req->getId());
+        if (node == INDEX_NONE) {
+            return false;
+        }
+        if (_cacheList[node].size != req->getSize()) {
+            // the object changed size: a miss, its stale copy is dropped
+            evictNode(node);
+            return false;
+        }
+        // log hit
+        LOG("h", 0, req->getId(), req->getSize());
+        HitUpdate::hit(_cacheList, node);
+        return true;
+    }
+
+    virtual void admit(SimpleRequest* req) {
+        const uint64_t size = req->getSize();
+        // object feasible to store?
+        if (size > _cacheSize) {
+            LOG("L", _cacheSize, req->getId(), size);
+            return;
+        }
+        // check eviction needed
+        while (_currentSize + size > _cacheSize) {
+            ListCache::evict();
+        }
+        // admit new object
+        CacheObject obj(req);
+        _cacheMap.insert(obj.id, _cacheList.pushFront(obj));
+        _currentSize += size;
+        LOG("a", _currentSize, obj.id, obj.size);
+    }
+
+    virtual void evict(SimpleRequest* req) {
+        const uint32_t node = _cacheMap.find(req->getId());
+        if (node != INDEX_NONE) {
+            evictNode(node);
+        }
+    }
+
+    virtual void evict() {
+        // evict least popular (i.e. last element)
+        if (!_cacheList.empty()) {
+            evictNode(_cacheList.back());
+        }
+    }
 };
 
+typedef ListCache<MoveToFront> LRUOrder;
+typedef ListCache<KeepPosition> FIFOOrder;
+
+/*
+  LRU: Least Recently Used eviction
+*/
+typedef ComposedCache<LRUOrder, AdmitAlways> LRUCache;
+
 static Factory<LRUCache> factoryLRU("LRU");
 
 /*
   FIFO: First-In First-Out eviction
 */
-class FIFOCache : public LRUCache
-{
-protected:
-    virtual void hit(lruCacheMapType::const_iterator it, uint64_t size);
-
-public:
-    FIFOCache()
-        : LRUCache()
-    {
-    }
-    virtual ~FIFOCache()
-    {
-    }
-};
+typedef ComposedCache<FIFOOrder, AdmitAlways> FIFOCache;
 
 static Factory<FIFOCache> factoryFIFO("FIFO");
 
 /*
   FilterCache (admit only after N requests)
 */
-class FilterCache : public LRUCache
-{
-protected:
-    uint64_t _nParam;
-    std::unordered_map<CacheObject, uint64_t> _filter;
-
-public:
-    FilterCache();
-    virtual ~FilterCache()
-    {
-    }
-
-    virtual void setPar(std::string parName, std::string parValue);
-    virtual bool lookup(SimpleRequest* req);
-    virtual void admit(SimpleRequest* req);
-};
+typedef ComposedCache<LRUOrder, AdmitNHit> FilterCache;
 
 static Factory<FilterCache> factoryFilter("Filter");
 
 /*
   ThLRU: LRU eviction with a size admission threshold
 */
-class ThLRUCache : public LRUCache
-{
-protected:
-    uint64_t _sizeThreshold;
-
-public:
-    ThLRUCache();
-    virtual ~ThLRUCache()
-    {
-    }
-
-    virtual void setPar(std::string parName, std::string parValue);
-    virtual void admit(SimpleRequest* req);
-};
+typedef ComposedCache<LRUOrder, AdmitThreshold> ThLRUCache;
 
 static Factory<ThLRUCache> factoryThLRU("ThLRU");
 
 /*
   ExpLRU: LRU eviction with size-aware probabilistic cache admission
 */
-class ExpLRUCache : public LRUCache
-{
-protected:
-    double _cParam;
-
-public:
-    ExpLRUCache();
-    virtual ~ExpLRUCache()
-    {
-    }
-
-    virtual void setPar(std::string parName, std::string parValue);
-    virtual void admit(SimpleRequest* req);
-};
+typedef ComposedCache<LRUOrder, AdmitExpProb> ExpLRUCache;
 
 static Factory<ExpLRUCache> factoryExpLRU("ExpLRU");
 
 /*
   AdaptSize: ExpLRU with automatic adaption of the _cParam
+
+  by default the reconfiguration runs inline on the request path, so the
+  results are reproducible. in asynchronous mode (parameter a=1) the
+  request statistics of each interval are handed to a background thread
+  and merged there, each on its own, so the EWMA weights don't change.
+  the thread searches a new _cParam after every merge, lookups continue
+  with the old one until it is published. one finished interval can wait
+  while the thread is busy, a further one is dropped, so the interval
+  length stays fixed.
+
+  with parameter h=1 the long-term statistics are a RateSizeHistogram
+  instead of per-object entries, so their memory doesn't grow with the
+  number of objects. h=2 takes _cParam from the histogram, but keeps the
+  exact statistics as well and reports how far the two models disagree.
 */
-class AdaptSizeCache : public LRUCache
+class AdaptSizeAdmission
 {
-public: 
-    AdaptSizeCache();
-    virtual ~AdaptSizeCache()
-    {
+public:
+    AdaptSizeAdmission();
+    ~AdaptSizeAdmission();
+
+    bool setPar(const std::string& parName, const std::string& parValue);
+    // p (model threads) and a (async mode) change how the reconfiguration
+    // runs, not the random stream it should see
+    bool isPerformancePar(const std::string& parName) const {
+        return parName == "p" || parName == "a";
     }
+    void setDenseIds(uint64_t idCount);
+    void setRandomKey(uint64_t key) {
+        _random.seed(key);
+    }
+    void onLookup(SimpleRequest* req, const Cache& cache);
+    bool admit(SimpleRequest* req, const Cache& cache);
 
-    virtual void setPar(std::string parName, std::string parValue);
-    virtual bool lookup(SimpleRequest*);
-    virtual void admit(SimpleRequest*);
-
-private: 
-    double _cParam; //
-    uint64_t statSize;
+private:
+    std::atomic<double> _cParam; //
+    uint64_t statSize; // owned by the background thread in async mode
     uint64_t _maxIterations;
     uint64_t _reconfiguration_interval;
     uint64_t _nextReconfiguration;
+    // threads of the model passes (parameter p)
+    std::unique_ptr<ModelPool> _modelPool;
     double _gss_v;  // golden section search book parameters
-    // for random number generation 
-    std::uniform_real_distribution<double> _uniform_real_distribution = 
-        std::uniform_real_distribution<double>(0.0, 1.0); 
+    // admission thresholds for _cParam, rebuilt by the request path when
+    // _cParam has changed
+    ExpAdmissionTable _admissionTable;
+    RandomStream _random;
 
     struct ObjInfo {
         double requestCount; // requestRate in adaptsize_stub.h
@@ -158,55 +218,211 @@ private:
 
         ObjInfo() : requestCount(0.0), objSize(0) { }
     };
+    // account an object's size change in statSize
+    void resizeStat(uint64_t oldSize, uint64_t newSize) {
+        statSize -= oldSize;
+        statSize += newSize;
+    }
+    // requests of one reconfiguration interval, by object id
+    // dense-id mode: the stats of ids below the bound live in flat arrays,
+    // a requestCount of 0 marks an untracked id
+    struct IntervalStats {
+        std::unordered_map<CacheObject, ObjInfo> metadata;
+        std::vector<ObjInfo> dense;
+        std::vector<IdType> ids;
+    };
+    // the request path records into _intervals[_currentInterval]. in
+    // async mode a finished interval waits in _queuedInterval until the
+    // background thread merges it in _workerInterval
+    static const unsigned NO_INTERVAL = 3;
+    IntervalStats _intervals[3];
+    unsigned _currentInterval;
+
+    // owned by the background thread in async mode
     std::unordered_map<CacheObject, ObjInfo> _longTermMetadata;
-    std::unordered_map<CacheObject, ObjInfo> _intervalMetadata;
-
-    void reconfigure();
-    double modelHitRate(double c);
-
-    // align data for vectorization
-    std::vector<double> _alignedReqCount;
-    std::vector<double> _alignedObjSize;
-    std::vector<double> _alignedAdmProb;
+    std::vector<ObjInfo> _denseLongTerm;
+    std::vector<IdType> _longTermIds;
+
+    // async mode
+    bool _async;
+    std::thread _worker;
+    std::mutex _workerMutex;
+    std::condition_variable _workerCv;
+    unsigned _queuedInterval; // NO_INTERVAL if none
+    unsigned _workerInterval; // NO_INTERVAL if the worker isn't merging
+    std::atomic<bool> _workerStop; // also ends a running parameter search
+    uint64_t _workerCacheSize;
+    // reported when the background thread ends
+    uint64_t _mergedIntervals; // owned by the background thread
+    uint64_t _droppedIntervals; // owned by the request path
+    uint64_t _searches; // owned by the background thread
+
+    // model inputs, aligned for vectorization. one element per object of
+    // the exact stats, or per histogram bin (weight: objects in the bin)
+    struct ModelArrays {
+        std::vector<double> reqCount;
+        std::vector<double> objSize;
+        std::vector<double> weight;
+        std::vector<double> admProb;
+        double totalReqCount;
+
+        ModelArrays() : totalReqCount(0.0) { }
+        void clear();
+        void push(double rate, double size, double w);
+        // pad for the vector kernels, padding elements contribute nothing
+        void pad();
+    };
+    ModelArrays _exactModel;
+    ModelArrays _histModel;
+
+    // 0: exact stats, 1: histogram only, 2: both (see above)
+    unsigned _histogramMode;
+    RateSizeHistogram _intervalHistogram;
+    RateSizeHistogram _longTermHistogram;
+
+    void reconfigure(const Cache& cache);
+    // merge an interval into the long-term stats of the histogram mode
+    void updateStats(IntervalStats& interval);
+    // merge an interval into the exact long-term stats and refill _exactModel
+    void mergeInterval(IntervalStats& interval);
+    // merge an interval into the long-term histogram and refill _histModel
+    void mergeHistogram(IntervalStats& interval);
+    // forget the stats of an interval
+    void clearInterval(IntervalStats& interval);
+    // set _cParam from the model of the histogram mode
+    void chooseParameter(uint64_t cacheSize);
+    // search the best log2 c on a model, false on numerical failure or
+    // when the background thread is stopped
+    bool searchParameter(ModelArrays& model, uint64_t cacheSize, double& log2c);
+    void handOff(uint64_t cacheSize);
+    void reconfigureWorker();
+    double modelHitRate(ModelArrays& model, double log2c, uint64_t cacheSize);
 };
 
+typedef ComposedCache<LRUOrder, AdaptSizeAdmission> AdaptSizeCache;
+
 static Factory<AdaptSizeCache> factoryAdaptSize("AdaptSize");
 
 /*
-  S4LRU
+  SnLRU: segmented LRU with n segments (S4LRU for n=4)
 
   enter at segment 0
   if hit on segment i, segment i+1
   if evicted on segment i, segment i-1
 
+  [implementation: one index for all segments, whose list nodes carry
+  their segment. the segments are lists in one slab, so promotion and
+  demotion relink nodes in constant time without allocation]
 */
-class S4LRUCache : public Cache
+struct SegmentObject
+{
+    CacheObject obj;
+    uint32_t segment;
+};
+
+class SegmentedLRUOrder : public Cache
 {
 protected:
-    LRUCache segments[4];
+    // segment lists in eviction order (demoted/evicted from the back)
+    SlabList<SegmentObject> _segmentLists;
+    // flat hash table (or array in dense-id mode) to find objects' nodes
+    ObjectIndex _cacheMap;
+    // capacity and used bytes of each segment
+    std::vector<uint64_t> _segmentSize;
+    std::vector<uint64_t> _segmentCurrentSize;
+
+    void resizeSegments();
+    // link an unlinked node into segment, demoting objects from its back
+    void segmentAdmit(uint32_t segment, uint32_t node);
+
+    // remove the object of a node from its segment
+    void evictNode(uint32_t node) {
+        const CacheObject obj = _segmentLists[node].obj;
+        const uint32_t segment = _segmentLists[node].segment;
+        LOG("e", _currentSize, obj.id, obj.size);
+        _segmentCurrentSize[segment] -= obj.size;
+        _currentSize -= obj.size;
+        _cacheMap.erase(obj.id);
+        _segmentLists.erase(node, segment);
+    }
 
 public:
-    S4LRUCache()
-        : Cache()
-    {
-        segments[0] = LRUCache();
-        segments[1] = LRUCache();
-        segments[2] = LRUCache();
-        segments[3] = LRUCache();
-    }
-    virtual ~S4LRUCache()
+    SegmentedLRUOrder();
+    virtual ~SegmentedLRUOrder()
     {
     }
 
+    // n: number of segments (set before the replay)
+    bool setOrderPar(const std::string& parName, const std::string& parValue);
     virtual void setSize(uint64_t cs);
-    virtual bool lookup(SimpleRequest* req);
-    virtual void admit(SimpleRequest* req);
-    virtual void segment_admit(uint8_t idx, SimpleRequest* req);
-    virtual void evict(SimpleRequest* req);
-    virtual void evict();
+    virtual void setDenseIds(uint64_t idCount) {
+        _cacheMap.setDense(idCount);
+    }
+
+    virtual bool lookup(SimpleRequest* req) {
+        const uint32_t node = _cacheMap.find(req->getId());
+        if (node == INDEX_NONE) {
+            return false;
+        }
+        const CacheObject obj = _segmentLists[node].obj;
+        if (obj.size != req->getSize()) {
+            // the object changed size: a miss, its stale copy is dropped
+            evictNode(node);
+            return false;
+        }
+        LOG("h", 0, obj.id, obj.size);
+        const uint32_t segment = _segmentLists[node].segment;
+        if (segment + 1 < _segmentSize.size() && obj.size <= _segmentSize[segment + 1]) {
+            // move up
+            _segmentLists.unlink(node, segment);
+            _segmentCurrentSize[segment] -= obj.size;
+            segmentAdmit(segment + 1, node);
+        } else {
+            _segmentLists.moveToFront(node, segment);
+        }
+        return true;
+    }
+
+    virtual void admit(SimpleRequest* req) {
+        const uint64_t size = req->getSize();
+        // object feasible to store?
+        if (size > _segmentSize[0]) {
+            LOG("L", _segmentSize[0], req->getId(), size);
+            return;
+        }
+        // check eviction needed
+        while (_segmentCurrentSize[0] + size > _segmentSize[0]) {
+            SegmentedLRUOrder::evict();
+        }
+        // admit new object into segment 0
+        SegmentObject entry;
+        entry.obj = CacheObject(req);
+        entry.segment = 0;
+        _cacheMap.insert(entry.obj.id, _segmentLists.pushFront(entry, 0));
+        _segmentCurrentSize[0] += size;
+        _currentSize += size;
+        LOG("a", _currentSize, entry.obj.id, entry.obj.size);
+    }
+
+    virtual void evict(SimpleRequest* req) {
+        const uint32_t node = _cacheMap.find(req->getId());
+        if (node != INDEX_NONE) {
+            evictNode(node);
+        }
+    }
+
+    virtual void evict() {
+        // evict least popular object of segment 0
+        if (!_segmentLists.empty(0)) {
+            evictNode(_segmentLists.back(0));
+        }
+    }
 };
 
-static Factory<S4LRUCache> factoryS4LRU("S4LRU");
+typedef ComposedCache<SegmentedLRUOrder, AdmitAlways> SnLRUCache;
+
+static Factory<SnLRUCache> factorySnLRU("SnLRU");
+static Factory<SnLRUCache> factoryS4LRU("S4LRU");
 
 
 
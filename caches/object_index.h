@@ -0,0 +1,160 @@
+#ifndef OBJECT_INDEX_H
+#define OBJECT_INDEX_H
+
+#include <cstdint>
+#include <vector>
+#include "cache_object.h"
+
+// marks an empty bucket / a missing object
+const uint32_t INDEX_NONE = UINT32_MAX;
+
+/*
+  ObjectIndex: flat hash table from object ids to 32-bit slots
+
+  open addressing with linear probing and backward-shift deletion (no
+  tombstones). the table doubles at 50% load, so a cache in steady state
+  doesn't allocate. objects are keyed by id alone, their sizes are kept by
+  the policies.
+
+  in dense-id mode (setDense) ids below the bound are indexed directly in a
+  flat array of slots, without hashing; larger ids fall back to the hash
+  table.
+*/
+class ObjectIndex
+{
+protected:
+    struct Bucket
+    {
+        IdType id;
+        uint32_t slot;
+    };
+
+    std::vector<Bucket> _buckets;
+    size_t _mask;
+    size_t _count;
+
+    // dense-id mode: slot by id, INDEX_NONE if unused
+    std::vector<uint32_t> _dense;
+    size_t _denseCount;
+
+    size_t home(IdType id) const {
+        return mixHash(id) & _mask;
+    }
+
+    void grow() {
+        std::vector<Bucket> old(2 * _buckets.size());
+        old.swap(_buckets);
+        _mask = _buckets.size() - 1;
+        for (auto& b : _buckets) {
+            b.slot = INDEX_NONE;
+        }
+        for (auto& b : old) {
+            if (b.slot != INDEX_NONE) {
+                size_t i = home(b.id);
+                while (_buckets[i].slot != INDEX_NONE) {
+                    i = (i + 1) & _mask;
+                }
+                _buckets[i] = b;
+            }
+        }
+    }
+
+public:
+    ObjectIndex()
+        : _mask(15),
+          _count(0),
+          _denseCount(0)
+    {
+        _buckets.resize(_mask + 1);
+        for (auto& b : _buckets) {
+            b.slot = INDEX_NONE;
+        }
+    }
+
+    // index ids below idCount directly, the index must be empty
+    void setDense(uint64_t idCount) {
+        _dense.assign(idCount, INDEX_NONE);
+    }
+
+    // slot of id, INDEX_NONE if not indexed
+    uint32_t find(IdType id) const {
+        if (id < _dense.size()) {
+            return _dense[id];
+        }
+        for (size_t i = home(id); ; i = (i + 1) & _mask) {
+            const Bucket& b = _buckets[i];
+            if (b.slot == INDEX_NONE || b.id == id) {
+                return b.slot;
+            }
+        }
+    }
+
+    // id must not be indexed yet
+    void insert(IdType id, uint32_t slot) {
+        if (id < _dense.size()) {
+            _dense[id] = slot;
+            _denseCount++;
+            return;
+        }
+        if (2 * (_count + 1) > _buckets.size()) {
+            grow();
+        }
+        size_t i = home(id);
+        while (_buckets[i].slot != INDEX_NONE) {
+            i = (i + 1) & _mask;
+        }
+        _buckets[i].id = id;
+        _buckets[i].slot = slot;
+        _count++;
+    }
+
+    // change the slot of an indexed id
+    void update(IdType id, uint32_t slot) {
+        if (id < _dense.size()) {
+            _dense[id] = slot;
+            return;
+        }
+        size_t i = home(id);
+        while (_buckets[i].id != id) {
+            i = (i + 1) & _mask;
+        }
+        _buckets[i].slot = slot;
+    }
+
+    void erase(IdType id) {
+        if (id < _dense.size()) {
+            if (_dense[id] != INDEX_NONE) {
+                _dense[id] = INDEX_NONE;
+                _denseCount--;
+            }
+            return;
+        }
+        size_t i = home(id);
+        while (_buckets[i].slot != INDEX_NONE) {
+            if (_buckets[i].id == id) {
+                break;
+            }
+            i = (i + 1) & _mask;
+        }
+        if (_buckets[i].slot == INDEX_NONE) {
+            return;
+        }
+        _count--;
+        // shift back later entries of the probe sequence into the hole
+        for (size_t j = (i + 1) & _mask; _buckets[j].slot != INDEX_NONE; j = (j + 1) & _mask) {
+            const size_t h = home(_buckets[j].id);
+            // move j unless its home lies cyclically within (i, j]
+            if (((j - h) & _mask) >= ((j - i) & _mask)) {
+                _buckets[i] = _buckets[j];
+                i = j;
+            }
+        }
+        _buckets[i].slot = INDEX_NONE;
+    }
+
+    size_t size() const {
+        return _count + _denseCount;
+    }
+};
+
+#endif /* OBJECT_INDEX_H */
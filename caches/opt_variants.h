@@ -0,0 +1,172 @@
+#ifndef OPT_VARIANTS_H
+#define OPT_VARIANTS_H
+
+#include <vector>
+#include "cache.h"
+#include "cache_object.h"
+#include "object_index.h"
+#include "indexed_heap.h"
+#include "admission.h"
+#include "composed_cache.h"
+
+/*
+  Offline policies: they know each request's next access, so they need a
+  trace annotated by traceparser/annotate_trace and replay it unsampled
+  (the current time is the number of requests replayed so far)
+
+  priority functions for BeladyOrder, the smallest priority is evicted:
+    static double priority(next, now, size)
+*/
+
+/*
+  BeladyOrder: evicts the object with the smallest priority, computed from
+  the next access on admission and on each hit
+
+  a missed object is inserted before evicting, so an object that would be
+  the next victim itself bypasses the cache (optimal for equal sizes).
+  [implementation via the indexed 4-ary heap of the GD policies]
+*/
+template <class Priority>
+class BeladyOrder : public Cache
+{
+protected:
+    // cached objects by slot, freed slots are reused
+    std::vector<CacheObject> _slots;
+    std::vector<uint32_t> _freeSlots;
+    IndexedHeap _priorityHeap;
+    ObjectIndex _cacheMap;
+    // requests looked up so far, the current request's index + 1
+    uint64_t _requests;
+
+    double priority(const SimpleRequest* req) const {
+        return Priority::priority(req->getNextAccess(), _requests - 1, req->getSize());
+    }
+
+    void evictSlot(uint32_t slot) {
+        const CacheObject obj = _slots[slot];
+        LOG("e", _priorityHeap.value(slot), obj.id, obj.size);
+        _currentSize -= obj.size;
+        _priorityHeap.erase(slot);
+        _cacheMap.erase(obj.id);
+        _freeSlots.push_back(slot);
+    }
+
+public:
+    BeladyOrder()
+        : Cache(),
+          _requests(0)
+    {
+    }
+    virtual ~BeladyOrder()
+    {
+    }
+
+    bool setOrderPar(const std::string& parName, const std::string& parValue) {
+        return false;
+    }
+
+    virtual void setDenseIds(uint64_t idCount) {
+        _cacheMap.setDense(idCount);
+    }
+
+    virtual bool needsNextAccess() const {
+        return true;
+    }
+
+    virtual bool lookup(SimpleRequest* req) {
+        _requests++;
+        const uint32_t slot = _cacheMap.find(req->getId());
+        if (slot == INDEX_NONE) {
+            return false;
+        }
+        if (_slots[slot].size != req->getSize()) {
+            // the object changed size: a miss, its stale copy is dropped
+            evictSlot(slot);
+            return false;
+        }
+        LOG("h", 0, req->getId(), req->getSize());
+        _priorityHeap.update(slot, priority(req));
+        return true;
+    }
+
+    virtual void admit(SimpleRequest* req) {
+        const uint64_t size = req->getSize();
+        // object feasible to store?
+        if (size >= _cacheSize) {
+            LOG("error", _cacheSize, req->getId(), size);
+            return;
+        }
+        CacheObject obj(req);
+        uint32_t slot;
+        if (_freeSlots.empty()) {
+            slot = _slots.size();
+            _slots.push_back(obj);
+        } else {
+            slot = _freeSlots.back();
+            _freeSlots.pop_back();
+            _slots[slot] = obj;
+        }
+        LOG("a", priority(req), obj.id, obj.size);
+        _cacheMap.insert(obj.id, slot);
+        _priorityHeap.push(slot, priority(req));
+        _currentSize += size;
+        while (_currentSize > _cacheSize) {
+            BeladyOrder::evict();
+        }
+    }
+
+    virtual void evict(SimpleRequest* req) {
+        const uint32_t slot = _cacheMap.find(req->getId());
+        if (slot != INDEX_NONE) {
+            evictSlot(slot);
+        }
+    }
+
+    virtual void evict() {
+        if (!_priorityHeap.empty()) {
+            const uint32_t slot = _priorityHeap.top();
+            const CacheObject obj = _slots[slot];
+            LOG("e", _priorityHeap.topValue(), obj.id, obj.size);
+            _currentSize -= obj.size;
+            _cacheMap.erase(obj.id);
+            _priorityHeap.pop();
+            _freeSlots.push_back(slot);
+        }
+    }
+};
+
+/*
+  Belady: evicts the object whose next access is furthest in the future
+  (objects that are not requested again first)
+*/
+struct BeladyPriority
+{
+    static double priority(uint64_t next, uint64_t now, uint64_t size) {
+        return -static_cast<double>(next);
+    }
+};
+
+typedef ComposedCache<BeladyOrder<BeladyPriority>, AdmitAlways> BeladyCache;
+
+static Factory<BeladyCache> factoryBelady("Belady");
+
+/*
+  BeladySize: evicts the object with the largest product of size and
+  distance to its next access, i.e. the one that takes up most cache space
+  per hit
+
+  the distance is measured from the object's last request, so the
+  priorities don't change while time advances
+*/
+struct BeladySizePriority
+{
+    static double priority(uint64_t next, uint64_t now, uint64_t size) {
+        return -static_cast<double>(next - now) * static_cast<double>(size);
+    }
+};
+
+typedef ComposedCache<BeladyOrder<BeladySizePriority>, AdmitAlways> BeladySizeCache;
+
+static Factory<BeladySizeCache> factoryBeladySize("BeladySize");
+
+#endif /* OPT_VARIANTS_H */
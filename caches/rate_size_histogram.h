@@ -0,0 +1,109 @@
+#ifndef RATE_SIZE_HISTOGRAM_H
+#define RATE_SIZE_HISTOGRAM_H
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+/*
+  RateSizeHistogram: objects binned by log2 request rate and log2 size
+
+  each bin keeps the (fractional) number of objects and the sums of their
+  rates and sizes, so its objects are represented by their mean rate and
+  mean size. HISTOGRAM_BINS_PER_DOUBLING bins per power of two on both
+  axes, rates and sizes outside the covered range go to the outer bins.
+  the memory is fixed, independent of the number of objects.
+*/
+const int HISTOGRAM_BINS_PER_DOUBLING = 4;
+const int HISTOGRAM_RATE_LOG2_MIN = -8;
+const int HISTOGRAM_RATE_LOG2_MAX = 32;
+const int HISTOGRAM_SIZE_LOG2_MAX = 48;
+
+class RateSizeHistogram
+{
+public:
+    struct Bin
+    {
+        double weight;
+        double rateSum;
+        double sizeSum;
+    };
+
+    static const int RATE_BINS = (HISTOGRAM_RATE_LOG2_MAX - HISTOGRAM_RATE_LOG2_MIN) * HISTOGRAM_BINS_PER_DOUBLING;
+    static const int SIZE_BINS = HISTOGRAM_SIZE_LOG2_MAX * HISTOGRAM_BINS_PER_DOUBLING;
+
+protected:
+    std::vector<Bin> _bins; // rate-major
+
+    static int binIndex(double log2Value, int log2Min, int bins) {
+        const double i = std::floor((log2Value - log2Min) * HISTOGRAM_BINS_PER_DOUBLING);
+        if (!(i > 0)) {
+            return 0; // also for -inf and NaN
+        }
+        return i < bins ? int(i) : bins - 1;
+    }
+
+public:
+    RateSizeHistogram()
+    {
+        clear();
+    }
+
+    void clear() {
+        Bin empty = {0.0, 0.0, 0.0};
+        _bins.assign(RATE_BINS * SIZE_BINS, empty);
+    }
+
+    void add(double rate, double size, double weight = 1.0) {
+        const int r = binIndex(std::log2(rate), HISTOGRAM_RATE_LOG2_MIN, RATE_BINS);
+        const int s = binIndex(std::log2(size), 0, SIZE_BINS);
+        Bin& bin = _bins[r * SIZE_BINS + s];
+        bin.weight += weight;
+        bin.rateSum += weight * rate;
+        bin.sizeSum += weight * size;
+    }
+
+    // this = factor * this + otherFactor * other
+    void blend(double factor, const RateSizeHistogram& other, double otherFactor) {
+        for (size_t i = 0; i < _bins.size(); i++) {
+            Bin& bin = _bins[i];
+            const Bin& o = other._bins[i];
+            bin.weight = factor * bin.weight + otherFactor * o.weight;
+            bin.rateSum = factor * bin.rateSum + otherFactor * o.rateSum;
+            bin.sizeSum = factor * bin.sizeSum + otherFactor * o.sizeSum;
+        }
+    }
+
+    // empty the bins holding less than minWeight objects
+    void prune(double minWeight) {
+        for (auto& bin : _bins) {
+            if (bin.weight < minWeight) {
+                bin.weight = bin.rateSum = bin.sizeSum = 0.0;
+            }
+        }
+    }
+
+    bool empty() const {
+        for (const auto& bin : _bins) {
+            if (bin.weight > 0) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // total size of the binned objects
+    double totalSize() const {
+        double total = 0.0;
+        for (const auto& bin : _bins) {
+            total += bin.sizeSum;
+        }
+        return total;
+    }
+
+    const std::vector<Bin>& bins() const {
+        return _bins;
+    }
+};
+
+#endif /* RATE_SIZE_HISTOGRAM_H */
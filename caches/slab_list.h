@@ -0,0 +1,128 @@
+#ifndef SLAB_LIST_H
+#define SLAB_LIST_H
+
+#include <cstdint>
+#include <vector>
+#include "object_index.h" /* INDEX_NONE */
+
+/*
+  SlabList: doubly-linked lists of values kept in one slab
+
+  nodes are addressed by 32-bit indices and linked through 32-bit
+  prev/next fields. freed nodes are reused through a free list, so once
+  the slab has grown to the peak number of nodes no operation allocates.
+  a slab can hold several lists, which share the nodes (e.g. the segments
+  of SnLRU); list operations take the list number.
+*/
+template <class T>
+class SlabList
+{
+protected:
+    struct Node
+    {
+        T value;
+        uint32_t prev;
+        uint32_t next;
+    };
+
+    struct Ends
+    {
+        uint32_t head;
+        uint32_t tail;
+    };
+
+    std::vector<Node> _nodes;
+    std::vector<Ends> _lists;
+    uint32_t _free; // head of the free list, linked via next
+
+public:
+    explicit SlabList(size_t lists = 1)
+        : _free(INDEX_NONE)
+    {
+        Ends empty = {INDEX_NONE, INDEX_NONE};
+        _lists.assign(lists, empty);
+    }
+
+    T& operator[](uint32_t idx) {
+        return _nodes[idx].value;
+    }
+    const T& operator[](uint32_t idx) const {
+        return _nodes[idx].value;
+    }
+
+    uint32_t front(size_t list = 0) const {
+        return _lists[list].head;
+    }
+    uint32_t back(size_t list = 0) const {
+        return _lists[list].tail;
+    }
+    bool empty(size_t list = 0) const {
+        return _lists[list].head == INDEX_NONE;
+    }
+    uint32_t prev(uint32_t idx) const {
+        return _nodes[idx].prev;
+    }
+    uint32_t next(uint32_t idx) const {
+        return _nodes[idx].next;
+    }
+
+    // store value in a new node at the front of list, returns its index
+    uint32_t pushFront(const T& value, size_t list = 0) {
+        uint32_t idx = _free;
+        if (idx == INDEX_NONE) {
+            idx = _nodes.size();
+            _nodes.push_back(Node());
+        } else {
+            _free = _nodes[idx].next;
+        }
+        _nodes[idx].value = value;
+        linkFront(idx, list);
+        return idx;
+    }
+
+    // unlink the node from its list and free it
+    void erase(uint32_t idx, size_t list = 0) {
+        unlink(idx, list);
+        _nodes[idx].next = _free;
+        _free = idx;
+    }
+
+    void moveToFront(uint32_t idx, size_t list = 0) {
+        if (_lists[list].head != idx) {
+            unlink(idx, list);
+            linkFront(idx, list);
+        }
+    }
+
+    // insert a node that isn't in any list at the front of list
+    void linkFront(uint32_t idx, size_t list = 0) {
+        Ends& ends = _lists[list];
+        Node& node = _nodes[idx];
+        node.prev = INDEX_NONE;
+        node.next = ends.head;
+        if (ends.head != INDEX_NONE) {
+            _nodes[ends.head].prev = idx;
+        } else {
+            ends.tail = idx;
+        }
+        ends.head = idx;
+    }
+
+    // remove a node from list, it stays allocated
+    void unlink(uint32_t idx, size_t list = 0) {
+        Ends& ends = _lists[list];
+        Node& node = _nodes[idx];
+        if (node.prev != INDEX_NONE) {
+            _nodes[node.prev].next = node.next;
+        } else {
+            ends.head = node.next;
+        }
+        if (node.next != INDEX_NONE) {
+            _nodes[node.next].prev = node.prev;
+        } else {
+            ends.tail = node.prev;
+        }
+    }
+};
+
+#endif /* SLAB_LIST_H */
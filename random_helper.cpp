@@ -1,9 +1,12 @@
-#include <random>
 #include "random_helper.h"
 
-std::mt19937_64 globalGenerator;
-
-void seedGenerator()
+uint64_t randomKey(const std::string& config)
 {
-    globalGenerator.seed(SEED);
+    // FNV-1a of the configuration, started from SEED
+    uint64_t h = 14695981039346656037ULL ^ SEED;
+    for(const char c : config) {
+        h ^= static_cast<unsigned char>(c);
+        h *= 1099511628211ULL;
+    }
+    return h;
 }
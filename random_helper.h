@@ -1,11 +1,57 @@
 #ifndef RANDOM_HELPER_H
 #define RANDOM_HELPER_H
 
-#include <random>
+#include <cstdint>
+#include <string>
 
 const unsigned int SEED = 1534262824; // const seed for repeatable results
-extern std::mt19937_64 globalGenerator;
 
-void seedGenerator();
+/*
+  RandomStream: counter-based random numbers (SplitMix64 output function)
+
+  the i-th draw is a hash of the stream's key and i, so there is no state
+  shared between streams. each cache keys its stream by its configuration
+  (see randomKey), so its draws don't depend on which other caches are
+  replayed with it, nor on the threads they are replayed on.
+*/
+class RandomStream
+{
+protected:
+    uint64_t _key;
+    uint64_t _counter;
+
+    static uint64_t mix(uint64_t z) {
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+
+public:
+    typedef uint64_t result_type;
+
+    explicit RandomStream(uint64_t key = SEED)
+    {
+        seed(key);
+    }
+
+    void seed(uint64_t key) {
+        _key = mix(key);
+        _counter = 0;
+    }
+
+    uint64_t operator()() {
+        return mix(_key + ++_counter * 0x9e3779b97f4a7c15ULL);
+    }
+
+    static constexpr uint64_t min() {
+        return 0;
+    }
+    static constexpr uint64_t max() {
+        return UINT64_MAX;
+    }
+};
+
+// stream key of a cache configuration, derived from SEED
+uint64_t randomKey(const std::string& config);
 
 #endif /* RANDOM_HELPER_H */
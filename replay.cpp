@@ -0,0 +1,174 @@
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include "replay.h"
+#include "caches/cache_object.h"
+
+/*
+  SpatialSampler
+*/
+// mixHash(0) is 0, so without a salt object 0 would always be sampled.
+// the salt also keeps the sample independent of the object index hash.
+static const uint64_t SAMPLE_SALT = 0x5851f42d4c957f2dULL;
+
+SpatialSampler::SpatialSampler(double rate, uint64_t maxObjects)
+    : _threshold(rate >= 1.0 ? UINT64_MAX : std::ldexp(rate, 64)),
+      _maxObjects(maxObjects)
+{
+}
+
+size_t SpatialSampler::filter(const TraceRecord* in, size_t n, TraceRecord* out)
+{
+    size_t sampled = 0;
+    for (size_t i = 0; i < n; i++) {
+        const uint64_t h = mixHash(in[i].id ^ SAMPLE_SALT);
+        if (h >= _threshold) {
+            continue;
+        }
+        if (_maxObjects > 0 && _objectIds.insert(in[i].id).second) {
+            _objects.push(std::make_pair(h, in[i].id));
+            // drop the largest hashes until the sample fits again
+            while (_objectIds.size() > _maxObjects) {
+                _threshold = _objects.top().first;
+                _objectIds.erase(_objects.top().second);
+                _objects.pop();
+            }
+            if (h >= _threshold) {
+                continue;
+            }
+        }
+        out[sampled++] = in[i];
+    }
+    return sampled;
+}
+
+double SpatialSampler::getRate() const
+{
+    return std::ldexp(static_cast<double>(_threshold), -64);
+}
+
+// scale cache capacities to the sampled fraction of the object space
+static void scaleRuns(std::vector<CacheRun>& runs, double rate)
+{
+    for (auto& run : runs) {
+        run.cache->setSize(std::llround(run.cacheSize * rate));
+    }
+}
+
+static void replayBatch(CacheRun& run, const TraceRecord* batch, size_t n)
+{
+    run.reqs += n;
+    run.hits += run.cache->replay(batch, n);
+}
+
+void replayTrace(TraceReader& trace, std::vector<CacheRun>& runs,
+                 const ReplayOptions& options)
+{
+    const TraceRecord* batch;
+    size_t n;
+
+    std::unique_ptr<SpatialSampler> sampler;
+    std::vector<TraceRecord> sampledBatch;
+    double rate = 1.0;
+    if (options.sampleRate < 1.0 || options.sampleSize > 0) {
+        sampler.reset(new SpatialSampler(options.sampleRate, options.sampleSize));
+        sampledBatch.resize(TRACE_BATCH_SIZE);
+        rate = sampler->getRate();
+        scaleRuns(runs, rate);
+    }
+
+    // read the next batch, keeping only sampled requests
+    // rate changes are applied to the caches between batches
+    auto fetchBatch = [&](const TraceRecord*& next) -> size_t {
+        if (!sampler) {
+            return trace.nextBatch(next);
+        }
+        const TraceRecord* in;
+        size_t inN;
+        while ((inN = trace.nextBatch(in)) > 0) {
+            const size_t sampled = sampler->filter(in, inN, sampledBatch.data());
+            if (sampler->getRate() != rate) {
+                rate = sampler->getRate();
+                scaleRuns(runs, rate);
+            }
+            if (sampled > 0) {
+                next = sampledBatch.data();
+                return sampled;
+            }
+        }
+        std::cerr << "sampling rate " << rate << std::endl;
+        return 0;
+    };
+
+    unsigned threads = options.threads;
+    if (threads > runs.size()) {
+        threads = runs.size();
+    }
+    if (threads <= 1) {
+        while ((n = fetchBatch(batch)) > 0) {
+            for (auto& run : runs) {
+                replayBatch(run, batch, n);
+            }
+        }
+        return;
+    }
+
+    // the reading thread publishes one batch at a time, workers pick the
+    // runs of that batch from a shared counter and report back when done
+    std::mutex lock;
+    std::condition_variable batchReady;
+    std::condition_variable batchDone;
+    uint64_t generation = 0;
+    unsigned pending = 0;
+    std::atomic<size_t> nextRun(0);
+    batch = NULL;
+    n = 0;
+
+    auto worker = [&]() {
+        for (uint64_t gen = 1; ; gen++) {
+            {
+                std::unique_lock<std::mutex> guard(lock);
+                batchReady.wait(guard, [&]() { return generation >= gen; });
+            }
+            if (n == 0) {
+                return;
+            }
+            size_t i;
+            while ((i = nextRun.fetch_add(1)) < runs.size()) {
+                replayBatch(runs[i], batch, n);
+            }
+            std::lock_guard<std::mutex> guard(lock);
+            if (--pending == 0) {
+                batchDone.notify_one();
+            }
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < threads; t++) {
+        workers.push_back(std::thread(worker));
+    }
+
+    const TraceRecord* nextBatch;
+    size_t nextN;
+    do {
+        nextN = fetchBatch(nextBatch);
+        std::unique_lock<std::mutex> guard(lock);
+        batch = nextBatch;
+        n = nextN;
+        nextRun.store(0);
+        pending = threads;
+        generation++;
+        batchReady.notify_all();
+        if (nextN > 0) {
+            batchDone.wait(guard, [&]() { return pending == 0; });
+        }
+    } while (nextN > 0);
+
+    for (auto& w : workers) {
+        w.join();
+    }
+}
@@ -0,0 +1,79 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <cstdint>
+#include <memory>
+#include <queue>
+#include <string>
+#include <unordered_set>
+#include <vector>
+#include "cache.h"
+#include "trace_io.h"
+
+// one cache configuration and its replay statistics
+struct CacheRun
+{
+    std::string cacheType;
+    uint64_t cacheSize;
+    std::string paramSummary;
+    std::unique_ptr<Cache> cache;
+    uint64_t reqs;
+    uint64_t hits;
+
+    CacheRun()
+        : cacheSize(0),
+          reqs(0),
+          hits(0)
+    {
+    }
+};
+
+struct ReplayOptions
+{
+    // worker threads, the runs are spread over them
+    unsigned threads;
+    // spatial sampling (SHARDS): only objects whose hashed id falls below
+    // sampleRate are replayed, against caches scaled by sampleRate
+    double sampleRate;
+    // if set, lower the rate to keep at most sampleSize sampled objects
+    uint64_t sampleSize;
+
+    ReplayOptions()
+        : threads(1),
+          sampleRate(1.0),
+          sampleSize(0)
+    {
+    }
+};
+
+/*
+  SpatialSampler: keeps requests to a pseudo-random subset of objects
+
+  an object is sampled iff the salted hash of its id is below the threshold.
+  with a sample size limit, the threshold is lowered to the hash of the
+  largest sampled object whenever the limit is exceeded (fixed-size SHARDS)
+*/
+class SpatialSampler
+{
+protected:
+    uint64_t _threshold;
+    uint64_t _maxObjects;
+    // sampled objects (hash, id), largest hash on top
+    std::priority_queue<std::pair<uint64_t, IdType> > _objects;
+    std::unordered_set<IdType> _objectIds;
+
+public:
+    SpatialSampler(double rate, uint64_t maxObjects);
+
+    // filter n records into out, returns the number of sampled records
+    size_t filter(const TraceRecord* in, size_t n, TraceRecord* out);
+
+    double getRate() const;
+};
+
+// feed every request of the trace to all runs
+// the runs share the decoded batches read-only
+void replayTrace(TraceReader& trace, std::vector<CacheRun>& runs,
+                 const ReplayOptions& options);
+
+#endif /* REPLAY_H */
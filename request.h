@@ -6,25 +6,41 @@
 
 typedef uint64_t IdType;
 
+// next access of a request to an object that isn't requested again, or
+// of any request of a trace that isn't annotated
+const uint64_t NO_NEXT_ACCESS = UINT64_MAX;
+
+// one decoded trace request, also the on-disk record of annotated binary
+// traces (see trace_io.h)
+struct TraceRecord
+{
+    uint64_t time;
+    IdType id;
+    uint64_t size;
+    // index (from 0) of the next request to the same object in the trace
+    uint64_t next;
+};
+
 // Request information
 class SimpleRequest
 {
 private:
     IdType _id; // request object id
     uint64_t _size; // request size in bytes
+    uint64_t _time; // time column of the trace
+    uint64_t _next; // index of the next request to the object
 
 public:
     SimpleRequest()
     {
     }
-    virtual ~SimpleRequest()
-    {
-    }
 
     // Create request
     SimpleRequest(IdType id, uint64_t size)
         : _id(id),
-          _size(size)
+          _size(size),
+          _time(0),
+          _next(NO_NEXT_ACCESS)
     {
     }
 
@@ -32,6 +48,16 @@ public:
     {
         _id = id;
         _size = size;
+        _time = 0;
+        _next = NO_NEXT_ACCESS;
+    }
+
+    void reinit(const TraceRecord& rec)
+    {
+        _id = rec.id;
+        _size = rec.size;
+        _time = rec.time;
+        _next = rec.next;
     }
 
 
@@ -52,6 +78,19 @@ public:
     {
         return _size;
     }
+
+    // Get request time (the trace's time column, 0 if unknown)
+    uint64_t getTime() const
+    {
+        return _time;
+    }
+
+    // Get the trace index of the next request to the object
+    // (NO_NEXT_ACCESS unless the trace is annotated)
+    uint64_t getNextAccess() const
+    {
+        return _next;
+    }
 };
 
 
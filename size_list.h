@@ -0,0 +1,35 @@
+#ifndef SIZE_LIST_H
+#define SIZE_LIST_H
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// parse a comma-separated list of cache sizes in bytes into sizes, empty
+// fields (e.g. a trailing comma) are skipped
+// returns false if a field isn't an unsigned integer of at most 19 digits
+// (reported on stderr) or the list has no sizes
+inline bool parseSizeList(const std::string& list, std::vector<uint64_t>& sizes)
+{
+    size_t pos = 0;
+    while (pos <= list.size()) {
+        size_t next = list.find(',', pos);
+        if (next == std::string::npos) {
+            next = list.size();
+        }
+        const std::string field = list.substr(pos, next - pos);
+        pos = next + 1;
+        if (field.empty()) {
+            continue;
+        }
+        if (field.size() > 19 || field.find_first_not_of("0123456789") != std::string::npos) {
+            std::cerr << "invalid cache size: " << field << std::endl;
+            return false;
+        }
+        sizes.push_back(std::stoull(field));
+    }
+    return !sizes.empty();
+}
+
+#endif /* SIZE_LIST_H */
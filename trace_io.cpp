@@ -0,0 +1,387 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "trace_io.h"
+
+/*
+  TraceReader
+*/
+std::unique_ptr<TraceReader> TraceReader::open(const std::string& path,
+                                               bool prefetch)
+{
+    std::unique_ptr<TraceReader> reader;
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "cannot open trace " << path << std::endl;
+        return nullptr;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        std::cerr << "cannot stat trace " << path << std::endl;
+        ::close(fd);
+        return nullptr;
+    }
+    const size_t fileSize = st.st_size;
+
+    // detect binary traces by their magic
+    // (the version 1 header is a prefix of the current one)
+    BinaryTraceHeader header;
+    const size_t v1HeaderSize = binaryTraceHeaderSize(1);
+    if (fileSize < v1HeaderSize
+        || pread(fd, &header, v1HeaderSize, 0) != (ssize_t)v1HeaderSize
+        || memcmp(header.magic, BINARY_TRACE_MAGIC, sizeof(header.magic)) != 0) {
+        reader.reset(new TextTraceReader(fd, path));
+        if (prefetch) {
+            reader.reset(new PrefetchTraceReader(std::move(reader)));
+        }
+        return reader;
+    }
+
+    const size_t headerSize = binaryTraceHeaderSize(header.version);
+    const size_t recordSize = binaryTraceRecordSize(header.version);
+    if (headerSize == 0 || header.recordSize != recordSize) {
+        std::cerr << "unsupported binary trace version " << header.version
+                  << " (record size " << header.recordSize << ")" << std::endl;
+        ::close(fd);
+        return nullptr;
+    }
+    header.idCount = 0;
+    // the record count is divided out, so a corrupt one can't overflow
+    if (fileSize < headerSize
+        || pread(fd, &header, headerSize, 0) != (ssize_t)headerSize
+        || header.recordCount > (fileSize - headerSize) / recordSize) {
+        std::cerr << "truncated binary trace " << path << std::endl;
+        ::close(fd);
+        return nullptr;
+    }
+
+    void* map = mmap(NULL, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd); // the mapping keeps the file referenced
+    if (map == MAP_FAILED) {
+        std::cerr << "cannot map trace " << path << std::endl;
+        return nullptr;
+    }
+    // replay walks the file front to back
+    madvise(map, fileSize, MADV_SEQUENTIAL);
+    reader.reset(new BinaryTraceReader(map, fileSize, header));
+    return reader;
+}
+
+/*
+  TextTraceReader
+*/
+// bytes requested per read() call
+const size_t TEXT_READ_SIZE = 1 << 22;
+
+static inline bool isSpace(const char c)
+{
+    return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+TextTraceReader::TextTraceReader(int fd, const std::string& path)
+    : _fd(fd),
+      _bufPos(0),
+      _bufEnd(0),
+      _eof(false),
+      _failed(false),
+      _line(1),
+      _path(path)
+{
+    // one extra byte for the sentinel behind the last block
+    _buf.resize(TEXT_READ_SIZE + 1);
+    _batch.resize(TRACE_BATCH_SIZE);
+}
+
+TextTraceReader::~TextTraceReader()
+{
+    ::close(_fd);
+}
+
+// move the unparsed bytes to the front and append the next block
+bool TextTraceReader::refill()
+{
+    const size_t rest = _bufEnd - _bufPos;
+    memmove(&_buf[0], &_buf[_bufPos], rest);
+    _bufPos = 0;
+    _bufEnd = rest;
+    if (_buf.size() - 1 - _bufEnd < TEXT_READ_SIZE / 2) {
+        // a single field spans most of the buffer
+        _buf.resize(2 * _buf.size());
+    }
+    ssize_t r;
+    do {
+        r = read(_fd, &_buf[_bufEnd], _buf.size() - 1 - _bufEnd);
+    } while (r < 0 && errno == EINTR);
+    if (r < 0) {
+        std::cerr << "error reading trace " << _path << std::endl;
+        _eof = true;
+        _failed = true;
+        return false;
+    }
+    if (r == 0) {
+        _eof = true;
+    }
+    _bufEnd += r;
+    _buf[_bufEnd] = '\0'; // stops digit scans at the end of data
+    return r > 0;
+}
+
+size_t TextTraceReader::nextBatch(const TraceRecord*& batch)
+{
+    TraceRecord* out = _batch.data();
+    const size_t batchSize = _batch.size();
+    size_t n = 0;
+    batch = out;
+
+    while (n < batchSize) {
+        const char* const data = _buf.data();
+        // only parse up to the last separator, a field behind it might
+        // continue in the next block
+        size_t safeEnd = _bufEnd;
+        if (!_eof) {
+            while (safeEnd > _bufPos && !isSpace(data[safeEnd - 1])) {
+                safeEnd--;
+            }
+        }
+        const char* p = data + _bufPos;
+        const char* const end = data + safeEnd;
+
+        while (n < batchSize) {
+            const char* const recordStart = p;
+            const uint64_t recordLine = _line;
+            uint64_t fields[3];
+            int k;
+            for (k = 0; k < 3; k++) {
+                while (p < end && isSpace(*p)) {
+                    _line += (*p == '\n');
+                    p++;
+                }
+                if (p == end) {
+                    break;
+                }
+                const char* const digits = p;
+                uint64_t x = 0;
+                unsigned d = static_cast<unsigned char>(*p) - '0';
+                while (d <= 9) {
+                    x = 10 * x + d;
+                    d = static_cast<unsigned char>(*++p) - '0';
+                }
+                // fields are unsigned integers of at most 19 digits
+                if (p == digits || p - digits > 19 || (p < end && !isSpace(*p))) {
+                    std::cerr << "malformed trace " << _path << " at line "
+                              << _line << std::endl;
+                    _bufPos = _bufEnd;
+                    _eof = true;
+                    _failed = true;
+                    return n;
+                }
+                fields[k] = x;
+            }
+            if (k < 3) {
+                // incomplete record, retry after the next refill
+                if (_eof) {
+                    if (k > 0) {
+                        std::cerr << "incomplete record in trace " << _path
+                                  << " at line " << _line << std::endl;
+                        _failed = true;
+                    }
+                    break;
+                }
+                p = recordStart;
+                _line = recordLine;
+                break;
+            }
+            out[n].time = fields[0];
+            out[n].id = fields[1];
+            out[n].size = fields[2];
+            out[n].next = NO_NEXT_ACCESS;
+            n++;
+        }
+        _bufPos = p - data;
+
+        if (n == batchSize || _eof) {
+            break;
+        }
+        refill();
+    }
+    return n;
+}
+
+/*
+  BinaryTraceReader
+*/
+BinaryTraceReader::BinaryTraceReader(void* map, size_t mapLength,
+                                     const BinaryTraceHeader& header)
+    : _map(map),
+      _mapLength(mapLength),
+      _records(NULL),
+      _plainRecords(NULL),
+      _annotated(header.version == ANNOTATED_TRACE_VERSION),
+      _recordCount(header.recordCount),
+      _idCount(header.idCount),
+      _pos(0)
+{
+    const char* base = static_cast<const char*>(map) + binaryTraceHeaderSize(header.version);
+    if (binaryTraceRecordSize(header.version) == sizeof(TraceRecord)) {
+        _records = reinterpret_cast<const TraceRecord*>(base);
+    } else {
+        _plainRecords = reinterpret_cast<const PlainTraceRecord*>(base);
+        _batch.resize(TRACE_BATCH_SIZE);
+    }
+}
+
+BinaryTraceReader::~BinaryTraceReader()
+{
+    munmap(_map, _mapLength);
+}
+
+size_t BinaryTraceReader::nextBatch(const TraceRecord*& batch)
+{
+    const uint64_t remaining = _recordCount - _pos;
+    const size_t n = remaining < TRACE_BATCH_SIZE ? remaining : TRACE_BATCH_SIZE;
+    if (_records != NULL) {
+        batch = _records + _pos;
+    } else {
+        const PlainTraceRecord* in = _plainRecords + _pos;
+        for (size_t i = 0; i < n; i++) {
+            _batch[i].time = in[i].time;
+            _batch[i].id = in[i].id;
+            _batch[i].size = in[i].size;
+            _batch[i].next = NO_NEXT_ACCESS;
+        }
+        batch = _batch.data();
+    }
+    _pos += n;
+    return n;
+}
+
+/*
+  PrefetchTraceReader
+*/
+PrefetchTraceReader::PrefetchTraceReader(std::unique_ptr<TraceReader> source)
+    : _source(std::move(source)),
+      _produced(0),
+      _consumed(0),
+      _stop(false),
+      _failed(false),
+      _next(0)
+{
+    for (size_t i = 0; i < PREFETCH_SLOTS; i++) {
+        _slots[i].resize(TRACE_BATCH_SIZE);
+        _slotCount[i] = 0;
+    }
+    _thread = std::thread(&PrefetchTraceReader::produce, this);
+}
+
+PrefetchTraceReader::~PrefetchTraceReader()
+{
+    _stop.store(true);
+    _thread.join();
+}
+
+void PrefetchTraceReader::produce()
+{
+    for (uint64_t seq = 0; ; seq++) {
+        // wait for a free slot
+        while (seq - _consumed.load(std::memory_order_acquire) >= PREFETCH_SLOTS) {
+            if (_stop.load(std::memory_order_relaxed)) {
+                return;
+            }
+            std::this_thread::yield();
+        }
+        const size_t slot = seq % PREFETCH_SLOTS;
+        const TraceRecord* batch;
+        const size_t n = _source->nextBatch(batch);
+        std::copy(batch, batch + n, _slots[slot].begin());
+        _slotCount[slot] = n;
+        if (n == 0) {
+            _failed = _source->failed();
+        }
+        _produced.store(seq + 1, std::memory_order_release);
+        if (n == 0) {
+            // end of trace
+            return;
+        }
+    }
+}
+
+size_t PrefetchTraceReader::nextBatch(const TraceRecord*& batch)
+{
+    // release the slot handed out by the previous call
+    _consumed.store(_next, std::memory_order_release);
+    while (_produced.load(std::memory_order_acquire) <= _next) {
+        std::this_thread::yield();
+    }
+    const size_t slot = _next % PREFETCH_SLOTS;
+    const size_t n = _slotCount[slot];
+    if (n > 0) {
+        // keep returning the end-of-trace slot on repeated calls
+        _next++;
+    }
+    batch = _slots[slot].data();
+    return n;
+}
+
+/*
+  BinaryTraceWriter
+*/
+BinaryTraceWriter::BinaryTraceWriter()
+    : _file(NULL),
+      _annotated(false),
+      _recordCount(0),
+      _idBound(0),
+      _idCount(0)
+{
+}
+
+BinaryTraceWriter::~BinaryTraceWriter()
+{
+    if (_file != NULL) {
+        close();
+    }
+}
+
+bool BinaryTraceWriter::open(const std::string& path, bool annotated)
+{
+    _file = fopen(path.c_str(), "wb");
+    if (_file == NULL) {
+        std::cerr << "cannot open " << path << " for writing" << std::endl;
+        return false;
+    }
+    setvbuf(_file, NULL, _IOFBF, 1 << 20);
+    _annotated = annotated;
+    _recordCount = 0;
+    _idBound = 0;
+    _idCount = 0;
+    // write a placeholder header, the counts are patched by close()
+    BinaryTraceHeader header;
+    memset(&header, 0, sizeof(header));
+    fwrite(&header, sizeof(header), 1, _file);
+    return true;
+}
+
+bool BinaryTraceWriter::close()
+{
+    BinaryTraceHeader header;
+    memcpy(header.magic, BINARY_TRACE_MAGIC, sizeof(header.magic));
+    header.version = _annotated ? ANNOTATED_TRACE_VERSION : BINARY_TRACE_VERSION;
+    header.recordSize = binaryTraceRecordSize(header.version);
+    header.recordCount = _recordCount;
+    header.idCount = _idCount;
+    if (_idBound > _idCount && _idCount > 0) {
+        std::cerr << "ids up to " << _idBound - 1 << " exceed the declared bound "
+                  << _idCount << ", not declaring dense ids" << std::endl;
+        header.idCount = 0;
+    }
+    bool ok = !ferror(_file);
+    ok = ok && fseek(_file, 0, SEEK_SET) == 0;
+    ok = ok && fwrite(&header, sizeof(header), 1, _file) == 1;
+    ok = (fclose(_file) == 0) && ok;
+    _file = NULL;
+    return ok;
+}
@@ -0,0 +1,274 @@
+#ifndef TRACE_IO_H
+#define TRACE_IO_H
+
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <atomic>
+#include <thread>
+#include <memory>
+#include <string>
+#include <vector>
+#include "request.h"
+
+/*
+  Trace formats
+
+  text: space-separated "time id size" triples (see README)
+  binary: a BinaryTraceHeader followed by recordCount packed records,
+          stored in host byte order. versions 1 and 2 store
+          PlainTraceRecords. version 3 (annotated traces) stores
+          TraceRecords with each request's next access, version 4 stores
+          TraceRecords without (NO_NEXT_ACCESS), so both are replayed in
+          place
+*/
+
+// on-disk record of binary trace versions 1 and 2 (also used for
+// temporary files of the tools)
+struct PlainTraceRecord
+{
+    uint64_t time;
+    IdType id;
+    uint64_t size;
+};
+
+static_assert(sizeof(PlainTraceRecord) == 24, "binary trace records must be packed");
+static_assert(sizeof(TraceRecord) == 32, "annotated binary trace records must be packed");
+
+const char BINARY_TRACE_MAGIC[8] = {'W', 'C', 'S', 'T', 'R', 'A', 'C', 'E'};
+const uint32_t BINARY_TRACE_VERSION = 4;
+const uint32_t ANNOTATED_TRACE_VERSION = 3;
+
+struct BinaryTraceHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t recordSize; // sizeof(TraceRecord) of the writer
+    uint64_t recordCount;
+    // since version 2: all ids are dense integers below idCount, 0 if the
+    // ids are not dense (version 1 headers end before this field)
+    uint64_t idCount;
+};
+
+static_assert(sizeof(BinaryTraceHeader) == 32, "binary trace header must be packed");
+
+// header size of a binary trace version, 0 if the version is unknown
+inline size_t binaryTraceHeaderSize(uint32_t version)
+{
+    switch (version) {
+    case 1:
+        return 24;
+    case 2:
+    case ANNOTATED_TRACE_VERSION:
+    case BINARY_TRACE_VERSION:
+        return sizeof(BinaryTraceHeader);
+    default:
+        return 0;
+    }
+}
+
+// record size of a binary trace version
+inline size_t binaryTraceRecordSize(uint32_t version)
+{
+    return version <= 2 ? sizeof(PlainTraceRecord) : sizeof(TraceRecord);
+}
+
+// number of records handed out per batch
+const size_t TRACE_BATCH_SIZE = 1 << 16;
+
+/*
+  TraceReader: sequential access to a trace in batches of decoded records
+*/
+class TraceReader
+{
+public:
+    TraceReader() {}
+    virtual ~TraceReader() {}
+
+    // points batch to the next records, which stay valid until the next call
+    // returns the number of records in the batch, 0 at the end of the trace
+    virtual size_t nextBatch(const TraceRecord*& batch) = 0;
+
+    // the trace ended at an error (reported on stderr), not at its end
+    // valid once nextBatch has returned 0
+    virtual bool failed() const {
+        return false;
+    }
+
+    // all ids of the trace are dense integers below this bound, 0 if unknown
+    virtual uint64_t getIdCount() const {
+        return 0;
+    }
+
+    // the records carry their next access (annotated binary trace)
+    virtual bool isAnnotated() const {
+        return false;
+    }
+
+    // open a trace file, the binary format is detected by its magic
+    // prefetch: decode text traces on a background thread (binary traces
+    // are mapped, only the records of versions 1 and 2 are copied)
+    // returns nullptr (and reports the error) if the trace can't be read
+    static std::unique_ptr<TraceReader> open(const std::string& path,
+                                             bool prefetch = false);
+};
+
+/*
+  TextTraceReader: space-separated "time id size" triples
+
+  reads large blocks with read() and parses the digits in place, any
+  whitespace separates fields (as with operator>>)
+*/
+class TextTraceReader : public TraceReader
+{
+protected:
+    int _fd;
+    std::vector<char> _buf;
+    size_t _bufPos; // first unparsed byte
+    size_t _bufEnd; // end of valid data
+    bool _eof;
+    bool _failed;
+    uint64_t _line; // current line, for error messages
+    std::string _path;
+    std::vector<TraceRecord> _batch;
+
+    bool refill();
+
+public:
+    TextTraceReader(int fd, const std::string& path);
+    virtual ~TextTraceReader();
+
+    virtual size_t nextBatch(const TraceRecord*& batch);
+
+    virtual bool failed() const {
+        return _failed;
+    }
+};
+
+/*
+  BinaryTraceReader: memory-maps the trace and hands out its records in
+  place, the records of versions 1 and 2 are converted into a batch buffer
+*/
+class BinaryTraceReader : public TraceReader
+{
+protected:
+    void* _map;
+    size_t _mapLength;
+    const TraceRecord* _records; // since version 3
+    const PlainTraceRecord* _plainRecords; // versions 1 and 2
+    bool _annotated;
+    uint64_t _recordCount;
+    uint64_t _idCount;
+    uint64_t _pos;
+    std::vector<TraceRecord> _batch;
+
+public:
+    // header: the validated header of the mapped trace
+    BinaryTraceReader(void* map, size_t mapLength, const BinaryTraceHeader& header);
+    virtual ~BinaryTraceReader();
+
+    virtual size_t nextBatch(const TraceRecord*& batch);
+
+    virtual uint64_t getIdCount() const {
+        return _idCount;
+    }
+
+    virtual bool isAnnotated() const {
+        return _annotated;
+    }
+
+    uint64_t getRecordCount() const {
+        return _recordCount;
+    }
+};
+
+/*
+  PrefetchTraceReader: decodes batches of another reader on a background
+  thread
+
+  batches are copied into a single-producer/single-consumer ring of
+  PREFETCH_SLOTS slots, a slot is released by the next call to nextBatch
+*/
+const size_t PREFETCH_SLOTS = 4;
+
+class PrefetchTraceReader : public TraceReader
+{
+protected:
+    std::unique_ptr<TraceReader> _source;
+    std::vector<TraceRecord> _slots[PREFETCH_SLOTS];
+    size_t _slotCount[PREFETCH_SLOTS];
+    // batches published by the producer / released by the consumer
+    std::atomic<uint64_t> _produced;
+    std::atomic<uint64_t> _consumed;
+    std::atomic<bool> _stop;
+    bool _failed; // published with the end-of-trace slot
+    uint64_t _next; // next batch handed to the consumer
+    std::thread _thread;
+
+    void produce();
+
+public:
+    explicit PrefetchTraceReader(std::unique_ptr<TraceReader> source);
+    virtual ~PrefetchTraceReader();
+
+    virtual size_t nextBatch(const TraceRecord*& batch);
+
+    virtual bool failed() const {
+        return _failed;
+    }
+
+    virtual uint64_t getIdCount() const {
+        return _source->getIdCount();
+    }
+
+    virtual bool isAnnotated() const {
+        return _source->isAnnotated();
+    }
+};
+
+/*
+  BinaryTraceWriter: writes records and patches the header on close
+
+  the header declares an id bound only if the caller knows the ids are
+  dense (setDenseIds). annotated traces keep the records' next accesses,
+  other traces store NO_NEXT_ACCESS.
+*/
+class BinaryTraceWriter
+{
+protected:
+    FILE* _file;
+    bool _annotated;
+    uint64_t _recordCount;
+    uint64_t _idBound; // largest id + 1
+    uint64_t _idCount; // declared by setDenseIds, 0 if not dense
+
+public:
+    BinaryTraceWriter();
+    ~BinaryTraceWriter();
+
+    bool open(const std::string& path, bool annotated = false);
+    void write(const TraceRecord& rec) {
+        if (_annotated) {
+            fwrite(&rec, sizeof(TraceRecord), 1, _file);
+        } else {
+            const TraceRecord plain = {rec.time, rec.id, rec.size, NO_NEXT_ACCESS};
+            fwrite(&plain, sizeof(TraceRecord), 1, _file);
+        }
+        _recordCount++;
+        if (rec.id >= _idBound) {
+            _idBound = rec.id + 1;
+        }
+    }
+    // all ids are dense integers below idCount (e.g. remapped ids)
+    void setDenseIds(uint64_t idCount) {
+        _idCount = idCount;
+    }
+    // returns false if any write failed
+    bool close();
+
+    uint64_t getRecordCount() const {
+        return _recordCount;
+    }
+};
+
+#endif /* TRACE_IO_H */
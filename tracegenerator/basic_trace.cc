@@ -1,17 +1,20 @@
 #include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cmath>
 #include <stdexcept>
-#include <stdio.h>
 #include <iostream>
 #include <fstream>
 #include <random>
-#include <list>
-#include <iomanip>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <memory>
+#include <thread>
+#include "trace_io.h"
 
 using namespace std;
 
-typedef tuple<long double, unsigned long> fi_pair_t;
-typedef list<fi_pair_t>::iterator list_iterator_t;
-
 // inversion method for bounded Pareto
 // uniform sample us, shape a (alpha), lower bound l, upper bound h
 double rbpareto(double us, double a, double l, double h)
@@ -20,26 +23,196 @@ double rbpareto(double us, double a, double l, double h)
   return( l/ pow( 1+us*(pow(l/h,a)-1), 1.0/a) );
 }
 
+// destination of the generated requests, in time order
+class RequestSink
+{
+public:
+  virtual ~RequestSink() {}
+  virtual void write(const TraceRecord& rec) = 0;
+  // returns false if any write failed
+  virtual bool close() = 0;
+};
+
+class TextSink : public RequestSink
+{
+protected:
+  ofstream _out;
+
+public:
+  bool open(const string& path) {
+    _out.open(path);
+    return _out.good();
+  }
+  void write(const TraceRecord& rec) {
+    _out << rec.time << " " << rec.id << " " << rec.size << "\n";
+  }
+  bool close() {
+    _out.close();
+    return !_out.fail();
+  }
+};
+
+class BinarySink : public RequestSink
+{
+protected:
+  BinaryTraceWriter _out;
+
+public:
+  bool open(const string& path, uint64_t idCount) {
+    if(!_out.open(path))
+      return false;
+    _out.setDenseIds(idCount);
+    return true;
+  }
+  void write(const TraceRecord& rec) {
+    _out.write(rec);
+  }
+  bool close() {
+    return _out.close();
+  }
+};
+
+// headerless plain records of one time slice, concatenated by the main thread
+class PartSink : public RequestSink
+{
+protected:
+  FILE* _file;
+
+public:
+  PartSink() : _file(nullptr) {}
+  ~PartSink() {
+    if(_file != nullptr)
+      fclose(_file);
+  }
+  bool open(const string& path) {
+    _file = fopen(path.c_str(), "wb");
+    return _file != nullptr;
+  }
+  void write(const TraceRecord& rec) {
+    const PlainTraceRecord plain = {rec.time, rec.id, rec.size};
+    fwrite(&plain, sizeof(plain), 1, _file);
+  }
+  bool close() {
+    const bool ok = !ferror(_file);
+    const bool closed = fclose(_file) == 0;
+    _file = nullptr;
+    return ok && closed;
+  }
+};
+
+struct Arrival
+{
+  double time;
+  uint64_t id;
+
+  // min-heap order for the std heap functions
+  bool operator<(const Arrival& rhs) const {
+    return time > rhs.time;
+  }
+};
+
+/*
+  generates the requests in the time slice [begin, end) in time order
+
+  each object's requests are a Poisson process, so its first arrival in
+  the slice is begin plus an exponential inter-arrival time and slices
+  are independent. the heap holds the next arrival of each object, so the
+  memory is O(objects) and each request costs O(log objects).
+*/
+static bool generateSlice(const vector<uint64_t>& size, const vector<double>& rate,
+                          double begin, double end, seed_seq& seed, RequestSink& out)
+{
+  mt19937_64 rnd_gen(seed);
+  exponential_distribution<double> iaRand;
+  typedef exponential_distribution<double>::param_type Rate;
+
+  vector<Arrival> heap;
+  heap.reserve(size.size());
+  for(uint64_t i=0; i<size.size(); i++) {
+    const Arrival first = {begin + iaRand(rnd_gen, Rate(rate[i])), i};
+    if(first.time < end)
+      heap.push_back(first);
+  }
+  make_heap(heap.begin(), heap.end());
+
+  TraceRecord rec;
+  rec.next = NO_NEXT_ACCESS;
+  while(!heap.empty()) {
+    pop_heap(heap.begin(), heap.end());
+    Arrival& next = heap.back();
+    rec.time = llround(1000*next.time);
+    rec.id = next.id;
+    rec.size = size[next.id];
+    out.write(rec);
+    next.time += iaRand(rnd_gen, Rate(rate[next.id]));
+    if(next.time < end) {
+      push_heap(heap.begin(), heap.end());
+    } else {
+      heap.pop_back();
+    }
+  }
+  return out.close();
+}
+
+// appends a part file to out and removes it
+static bool appendPart(const string& path, RequestSink& out)
+{
+  FILE* part = fopen(path.c_str(), "rb");
+  if(part == nullptr)
+    return false;
+  vector<PlainTraceRecord> batch(1 << 16);
+  TraceRecord rec;
+  rec.next = NO_NEXT_ACCESS;
+  size_t n;
+  while((n = fread(batch.data(), sizeof(PlainTraceRecord), batch.size(), part)) > 0) {
+    for(size_t i=0; i<n; i++) {
+      rec.time = batch[i].time;
+      rec.id = batch[i].id;
+      rec.size = batch[i].size;
+      out.write(rec);
+    }
+  }
+  const bool ok = !ferror(part);
+  fclose(part);
+  remove(path.c_str());
+  return ok;
+}
+
 int main (int argc, char* argv[])
 {
   // parameters
-  if(argc!=7) {
-    cout << "\n number_of_objects repetition_count pareto_shape lower_pareto_bound higher_pareto_bound outputname\n";
+  bool binary = false;
+  unsigned threads = 1;
+  uint64_t seed = random_device()();
+  vector<string> args;
+  for(int i=1; i<argc; i++) {
+    const string arg(argv[i]);
+    if(arg == "--binary") {
+      binary = true;
+    } else if(arg.compare(0, 10, "--threads=") == 0) {
+      threads = stoul(arg.substr(10));
+    } else if(arg.compare(0, 7, "--seed=") == 0) {
+      seed = stoull(arg.substr(7));
+    } else {
+      args.push_back(arg);
+    }
+  }
+  if(args.size()!=6 || threads==0) {
+    cout << "\n number_of_objects repetition_count pareto_shape lower_pareto_bound higher_pareto_bound outputname"
+         << " [--binary] [--threads=N] [--seed=S]\n";
     return 1;
   }
-  const long no_objs = atoi(argv[1]);
-  const long reps = atoi(argv[2]);
-  const double shape = atof(argv[3]);
-  const double lowerb = atof(argv[4]);
-  const double higherb = atof(argv[5]);
-  const string outputname(argv[6]);
-
-  auto * size = new long[no_objs];
-  list<fi_pair_t> reqseq;
+  const long no_objs = atol(args[0].c_str());
+  const long reps = atol(args[1].c_str());
+  const double shape = atof(args[2].c_str());
+  const double lowerb = atof(args[3].c_str());
+  const double higherb = atof(args[4].c_str());
+  const string outputname(args[5]);
 
-  // initialize object sizes
-  random_device rd;
-  mt19937 rnd_gen (rd ());
+  // initialize object sizes and request rates
+  vector<uint64_t> size(no_objs);
+  vector<double> rate(no_objs);
+  mt19937_64 rnd_gen(seed);
   double mean_size=0.0;
   uniform_real_distribution<> urng(0, 1);
   for (long i = 0; i < no_objs; i++) {
@@ -49,45 +222,73 @@ int main (int argc, char* argv[])
 	us = urng(rnd_gen);
       }
     while ((us == 0) || (us == 1));
+    double s;
     do
     {
-        size[i]=rbpareto(us,shape,lowerb,higherb);
+        s=rbpareto(us,shape,lowerb,higherb);
     }
-    while (size[i]<lowerb || size[i]>higherb);
+    while (s<lowerb || s>higherb);
+    size[i]=s;
     mean_size+=size[i];
+    rate[i] = 1/(pow(i+1,0.9));
   }
   cout << "finished sizes. mean_size: " << mean_size/static_cast<double>(no_objs) << "\n";
 
-  // initialize req sequence
-  for (long i = 0; i < no_objs; i++) {
-    const long double rateH = 1/(pow(i+1,0.9));
-    exponential_distribution<> iaRandH (rateH);
-    long double globalTime = iaRandH(rnd_gen);
-    while(globalTime<reps) {
-      reqseq.push_back(fi_pair_t(globalTime,i));
-      globalTime += iaRandH(rnd_gen);
+  unique_ptr<RequestSink> out;
+  if(binary) {
+    // the objects are numbered 0 .. no_objs-1
+    unique_ptr<BinarySink> sink(new BinarySink());
+    if(!sink->open(outputname, no_objs)) {
+      cerr << "cannot open " << outputname << endl;
+      return 1;
     }
-    //    cout << "markov high " << testh/testhc << " number " << testhc << " markov low " << testl/testlc << " number " << testlc << " changed states " << testchange << "\n";
+    out = move(sink);
+  } else {
+    unique_ptr<TextSink> sink(new TextSink());
+    if(!sink->open(outputname)) {
+      cerr << "cannot open " << outputname << endl;
+      return 1;
+    }
+    out = move(sink);
   }
-  // sort tuples lexicographically, i.e., by time
-  cout << "finished raw req sequence.\n";
-  reqseq.sort();
-  cout << "finished sorting req.\n";
 
-  ofstream outfile;
-  outfile.open(outputname);
-  outfile<<fixed<<setprecision(0); // turn of scientific notation
+  // one time slice per thread, each with its own random stream
+  vector<string> parts;
+  vector<PartSink> partSinks(threads > 1 ? threads : 0);
+  for(unsigned t=0; t<partSinks.size(); t++) {
+    parts.push_back(outputname + ".part" + to_string(t));
+    if(!partSinks[t].open(parts[t])) {
+      cerr << "cannot open " << parts[t] << endl;
+      return 1;
+    }
+  }
+  vector<char> sliceOk(threads, 0);
+  auto slice = [&](unsigned t) {
+    seed_seq sliceSeed = {uint32_t(seed), uint32_t(seed >> 32), t + 1};
+    RequestSink& sink = partSinks.empty() ? *out : partSinks[t];
+    sliceOk[t] = generateSlice(size, rate, double(reps)*t/threads, double(reps)*(t+1)/threads,
+                               sliceSeed, sink);
+  };
+  vector<thread> pool;
+  for(unsigned t=1; t<threads; t++)
+    pool.emplace_back(slice, t);
+  slice(0);
+  for(auto& th : pool)
+    th.join();
+  cout << "finished req sequence.\n";
 
-  // output request sequence
-  list_iterator_t rit;
-  for (rit=reqseq.begin(); rit != reqseq.end(); ++rit) {
-    outfile << 1000*get<0>(*rit) << " " << get<1>(*rit) << " " << size[get<1>(*rit)] << "\n"; 
+  bool ok = all_of(sliceOk.begin(), sliceOk.end(), [](char c) { return c != 0; });
+  if(!parts.empty()) {
+    for(const auto& part : parts)
+      ok = appendPart(part, *out) && ok;
+    ok = out->close() && ok;
+  }
+  if(!ok) {
+    cerr << "error writing " << outputname << endl;
+    return 1;
   }
 
   cout << "finished output.\n";
-  outfile.close();
-
-  delete size;
 
   return 0;
 }
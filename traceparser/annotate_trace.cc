@@ -0,0 +1,165 @@
+#include <string>
+#include <iostream>
+#include <unordered_map>
+#include <vector>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "trace_io.h"
+
+using namespace std;
+
+// records per chunk of the backward pass (32MB of annotated records)
+const uint64_t DEFAULT_CHUNK_RECORDS = 1 << 20;
+
+static bool preadAll(int fd, void* buf, size_t len, off_t offset)
+{
+  char* p = static_cast<char*>(buf);
+  while(len > 0) {
+    const ssize_t r = pread(fd, p, len, offset);
+    if(r < 0 && errno == EINTR)
+      continue;
+    if(r <= 0)
+      return false;
+    p += r;
+    len -= r;
+    offset += r;
+  }
+  return true;
+}
+
+static bool pwriteAll(int fd, const void* buf, size_t len, off_t offset)
+{
+  const char* p = static_cast<const char*>(buf);
+  while(len > 0) {
+    const ssize_t r = pwrite(fd, p, len, offset);
+    if(r < 0 && errno == EINTR)
+      continue;
+    if(r <= 0)
+      return false;
+    p += r;
+    len -= r;
+    offset += r;
+  }
+  return true;
+}
+
+// annotates each request of a binary trace with the index of the next
+// request to the same object (annotated binary trace, for the offline
+// policies). the trace is read backwards in chunks, so only one chunk and
+// the objects' next accesses are held in memory, not the trace
+int main (int argc, char* argv[])
+{
+
+  // parameters
+  if(argc < 3 || argc > 4) {
+    cerr << "annotate_trace binaryTrace annotatedTrace [chunkRecords]" << endl;
+    return 1;
+  }
+
+  const char* inputFile = argv[1];
+  const char* outputFile = argv[2];
+  const uint64_t chunkRecords = argc > 3 ? stoull(argv[3]) : DEFAULT_CHUNK_RECORDS;
+  if(chunkRecords == 0) {
+    cerr << "chunkRecords needs to be positive" << endl;
+    return 1;
+  }
+
+  const int in = open(inputFile, O_RDONLY);
+  if(in < 0) {
+    cerr << "cannot open trace " << inputFile << endl;
+    return 1;
+  }
+  struct stat st;
+  BinaryTraceHeader header;
+  memset(&header, 0, sizeof(header));
+  const size_t v1HeaderSize = binaryTraceHeaderSize(1);
+  if(fstat(in, &st) != 0
+     || !preadAll(in, &header, v1HeaderSize, 0)
+     || memcmp(header.magic, BINARY_TRACE_MAGIC, sizeof(header.magic)) != 0) {
+    cerr << inputFile << " is no binary trace (convert it with rewrite_trace_binary)" << endl;
+    return 1;
+  }
+  const size_t headerSize = binaryTraceHeaderSize(header.version);
+  const size_t recordSize = binaryTraceRecordSize(header.version);
+  if(headerSize == 0 || header.recordSize != recordSize) {
+    cerr << "unsupported binary trace version " << header.version << endl;
+    return 1;
+  }
+  // the record count is divided out, so a corrupt one can't overflow
+  if(uint64_t(st.st_size) < headerSize
+     || !preadAll(in, &header, headerSize, 0)
+     || header.recordCount > (uint64_t(st.st_size) - headerSize) / recordSize) {
+    cerr << "truncated binary trace " << inputFile << endl;
+    return 1;
+  }
+  const uint64_t recordCount = header.recordCount;
+
+  const int out = open(outputFile, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if(out < 0) {
+    cerr << "cannot open " << outputFile << " for writing" << endl;
+    return 1;
+  }
+  const size_t outHeaderSize = binaryTraceHeaderSize(ANNOTATED_TRACE_VERSION);
+  if(ftruncate(out, outHeaderSize + recordCount * sizeof(TraceRecord)) != 0) {
+    cerr << "cannot allocate " << outputFile << endl;
+    return 1;
+  }
+
+  cout << "running..." << endl;
+
+  // index and size of the latest (in trace order: next) request to each object
+  unordered_map<IdType, pair<uint64_t, uint64_t> > nextAccess;
+  vector<char> inChunk(chunkRecords * recordSize);
+  vector<TraceRecord> outChunk(chunkRecords);
+  for(uint64_t end = recordCount; end > 0; ) {
+    const uint64_t begin = end > chunkRecords ? end - chunkRecords : 0;
+    const size_t n = end - begin;
+    if(!preadAll(in, inChunk.data(), n * recordSize, headerSize + begin * recordSize)) {
+      cerr << "error reading " << inputFile << endl;
+      return 1;
+    }
+    if(recordSize == sizeof(TraceRecord)) {
+      memcpy(outChunk.data(), inChunk.data(), n * sizeof(TraceRecord));
+    } else {
+      const PlainTraceRecord* plain = reinterpret_cast<const PlainTraceRecord*>(inChunk.data());
+      for(size_t i=0; i<n; i++) {
+        outChunk[i].time = plain[i].time;
+        outChunk[i].id = plain[i].id;
+        outChunk[i].size = plain[i].size;
+      }
+    }
+    for(size_t i=n; i-- > 0; ) {
+      TraceRecord& rec = outChunk[i];
+      auto inserted = nextAccess.emplace(rec.id, make_pair(begin + i, rec.size));
+      if(inserted.second) {
+        rec.next = NO_NEXT_ACCESS;
+      } else {
+        // a request with another size misses, it doesn't reuse this copy
+        const pair<uint64_t, uint64_t>& later = inserted.first->second;
+        rec.next = later.second == rec.size ? later.first : NO_NEXT_ACCESS;
+        inserted.first->second = make_pair(begin + i, rec.size);
+      }
+    }
+    if(!pwriteAll(out, outChunk.data(), n * sizeof(TraceRecord),
+                  outHeaderSize + begin * sizeof(TraceRecord))) {
+      cerr << "error writing " << outputFile << endl;
+      return 1;
+    }
+    end = begin;
+  }
+  close(in);
+
+  header.version = ANNOTATED_TRACE_VERSION;
+  header.recordSize = sizeof(TraceRecord);
+  if(!pwriteAll(out, &header, outHeaderSize, 0) || close(out) != 0) {
+    cerr << "error writing " << outputFile << endl;
+    return 1;
+  }
+
+  cout << "annotated " << recordCount << " requests to " << nextAccess.size() << " objects" << endl;
+
+  return 0;
+}
@@ -0,0 +1,85 @@
+#include <cstdio>
+#include <string>
+#include <iostream>
+#include <vector>
+#include "trace_io.h"
+
+using namespace std;
+
+// converts a space-separated "time id size" trace into the binary trace format
+int main (int argc, char* argv[])
+{
+
+  // parameters
+  if(argc != 3) {
+    cerr << "rewrite_trace_binary textTrace binaryTrace" << endl;
+    return 1;
+  }
+
+  const char* inputFile = argv[1];
+  const char* outputFile = argv[2];
+
+  cout << "running..." << endl;
+
+  unique_ptr<TraceReader> infile = TraceReader::open(inputFile);
+  if(infile == nullptr)
+    return 1;
+
+  BinaryTraceWriter outfile;
+  if(!outfile.open(outputFile))
+    return 1;
+
+  // the ids are dense if at least half of the ids below the largest one
+  // occur. the bitmap only tracks ids below twice the records read so far
+  // plus 2^26 (8 MB), a larger id ends the check and the ids count as
+  // sparse. remapped ids occur in order, so they always stay below the
+  // number of records read so far
+  vector<bool> seen;
+  uint64_t distinctIds = 0;
+  bool dense = true;
+  const TraceRecord* batch;
+  size_t n;
+  while((n = infile->nextBatch(batch)) > 0) {
+    for(size_t i=0; i<n; i++) {
+      outfile.write(batch[i]);
+      const IdType id = batch[i].id;
+      if(!dense)
+        continue;
+      if(id >= 2 * outfile.getRecordCount() + (1 << 26)) {
+        dense = false;
+        seen.clear();
+        seen.shrink_to_fit();
+        continue;
+      }
+      if(id >= seen.size())
+        seen.resize(2 * id + 1);
+      if(!seen[id]) {
+        seen[id] = true;
+        distinctIds++;
+      }
+    }
+  }
+  if(infile->getIdCount() > 0) {
+    outfile.setDenseIds(infile->getIdCount());
+  } else if(dense) {
+    uint64_t idBound = seen.size();
+    while(idBound > 0 && !seen[idBound - 1])
+      idBound--;
+    if(idBound > 0 && 2 * distinctIds >= idBound)
+      outfile.setDenseIds(idBound);
+  }
+
+  const uint64_t t = outfile.getRecordCount();
+  const bool written = outfile.close();
+  if(infile->failed() || !written) {
+    if(!written)
+      cerr << "error writing " << outputFile << endl;
+    // don't leave a truncated trace that looks complete
+    remove(outputFile);
+    return 1;
+  }
+
+  cout << "rewrote " << t << " requests" << endl;
+
+  return 0;
+}
@@ -1,74 +1,210 @@
-#include <fstream>
 #include <string>
 #include <regex>
+#include <thread>
 #include "caches/lru_variants.h"
 #include "caches/gd_variants.h"
+#include "caches/opt_variants.h"
 #include "request.h"
+#include "random_helper.h"
+#include "trace_io.h"
+#include "size_list.h"
+#include "replay.h"
+#include "analysis/lru_mrc.h"
 
 using namespace std;
 
+static void usage()
+{
+  cerr << "webcachesim [--threads=N] [--sample=rate] [--sample-size=objects] [--max-id=N] [--ttl=time] traceFile cacheType cacheSizeBytes[,cacheSizeBytes...] [cacheParams]"
+       << " [+ cacheType cacheSizeBytes [cacheParams] ...]" << endl
+       << "webcachesim --mrc=pointsPerDoubling traceFile" << endl;
+}
+
 int main (int argc, char* argv[])
 {
 
+  // driver options (--name=value) may appear anywhere
+  ReplayOptions options;
+  options.threads = thread::hardware_concurrency();
+  unsigned mrcPoints = 0;
+  // dense-id mode: ids are integers below idCount (0: off)
+  uint64_t idCount = 0;
+  // time-to-live of cached objects in trace time units (0: no expiry)
+  uint64_t ttl = 0;
+  regex optexp ("--(.*)=(.*)");
+  regex opexp ("(.*)=(.*)");
+  smatch opmatch;
+  vector<string> args;
+  for(int i=1; i<argc; i++) {
+    const string arg = argv[i];
+    if(arg.compare(0, 2, "--") != 0) {
+      args.push_back(arg);
+      continue;
+    }
+    if(!regex_match (arg,opmatch,optexp)) {
+      cerr << "each option needs to be in form --name=value" << endl;
+      return 1;
+    }
+    if(opmatch[1] == "threads") {
+      options.threads = stoul(opmatch[2]);
+    } else if(opmatch[1] == "sample") {
+      options.sampleRate = stod(opmatch[2]);
+      if(options.sampleRate <= 0 || options.sampleRate > 1) {
+        cerr << "sample rate needs to be in (0,1]" << endl;
+        return 1;
+      }
+    } else if(opmatch[1] == "sample-size") {
+      options.sampleSize = stoull(opmatch[2]);
+    } else if(opmatch[1] == "max-id") {
+      idCount = stoull(opmatch[2]) + 1;
+    } else if(opmatch[1] == "ttl") {
+      ttl = stoull(opmatch[2]);
+    } else if(opmatch[1] == "mrc") {
+      mrcPoints = stoul(opmatch[2]);
+    } else {
+      cerr << "unrecognized option: " << arg << endl;
+      return 1;
+    }
+  }
+
+  // LRU miss ratio curve mode
+  if(mrcPoints > 0) {
+    if(args.size() != 1) {
+      usage();
+      return 1;
+    }
+    unique_ptr<TraceReader> trace = TraceReader::open(args[0], true);
+    if(trace == nullptr)
+      return 1;
+
+    cerr << "running..." << endl;
+
+    LRUMissRatioCurve mrc(mrcPoints);
+    const TraceRecord* batch;
+    size_t n;
+    while((n = trace->nextBatch(batch)) > 0) {
+      for(size_t i=0; i<n; i++)
+        mrc.request(batch[i].id, batch[i].size);
+    }
+    if(trace->failed())
+      return 1;
+    mrc.print(cout);
+    return 0;
+  }
+
   // output help if insufficient params
-  if(argc < 4) {
-    cerr << "webcachesim traceFile cacheType cacheSizeBytes [cacheParams]" << endl;
+  if(args.size() < 3) {
+    usage();
     return 1;
   }
 
   // trace properties
-  const char* path = argv[1];
+  const string path = args[0];
 
-  // create cache
-  const string cacheType = argv[2];
-  unique_ptr<Cache> webcache = Cache::create_unique(cacheType);
-  if(webcache == nullptr)
-    return 1;
+  // cache configurations, separated by "+"
+  // each configuration is replayed for every listed cache size
+  vector<CacheRun> runs;
+  size_t i = 1;
+  while(i < args.size()) {
+    if(args.size() - i < 2) {
+      usage();
+      return 1;
+    }
+    const string cacheType = args[i++];
+    const string cacheSizes = args[i++];
 
-  // configure cache size
-  const uint64_t cache_size  = std::stoull(argv[3]);
-  webcache->setSize(cache_size);
+    // parse cache parameters
+    CacheParams params;
+    string paramSummary;
+    for(; i<args.size() && args[i] != "+"; i++) {
+      if(!regex_match (args[i],opmatch,opexp)) {
+        cerr << "each cacheParam needs to be in form name=value" << endl;
+        return 1;
+      }
+      params.push_back(make_pair(opmatch[1], opmatch[2]));
+      paramSummary += opmatch[2];
+    }
+    if(i < args.size()) {
+      // skip separator
+      i++;
+      if(i == args.size()) {
+        usage();
+        return 1;
+      }
+    }
 
-  // parse cache parameters
-  regex opexp ("(.*)=(.*)");
-  cmatch opmatch;
-  string paramSummary;
-  for(int i=4; i<argc; i++) {
-    regex_match (argv[i],opmatch,opexp);
-    if(opmatch.size()!=3) {
-      cerr << "each cacheParam needs to be in form name=value" << endl;
+    vector<uint64_t> sizes;
+    if(!parseSizeList(cacheSizes, sizes)) {
+      usage();
       return 1;
     }
-    webcache->setPar(opmatch[1], opmatch[2]);
-    paramSummary += opmatch[2];
-  }
+    for(const uint64_t cacheSize : sizes) {
+      CacheRun run;
+      run.cacheType = cacheType;
+      run.paramSummary = paramSummary;
 
-  ifstream infile;
-  long long reqs = 0, hits = 0;
-  long long t, id, size;
+      // create cache
+      run.cache = Cache::create_unique(cacheType, params);
+      if(run.cache == nullptr)
+        return 1;
 
-  cerr << "running..." << endl;
+      // configure cache size
+      run.cacheSize = cacheSize;
+      run.cache->setSize(run.cacheSize);
+
+      // the cache's random stream depends on its configuration only,
+      // not on parameters that just change how fast it runs
+      string config = cacheType + " " + to_string(run.cacheSize);
+      for(auto& param : params) {
+        run.cache->setPar(param.first, param.second);
+        if(!run.cache->isPerformancePar(param.first))
+          config += " " + param.first + "=" + param.second;
+      }
+      run.cache->setRandomKey(randomKey(config));
+      run.cache->setTTL(ttl);
+
+      runs.push_back(move(run));
+    }
+  }
+
+  // open trace (text or binary), text is parsed on a background thread
+  unique_ptr<TraceReader> trace = TraceReader::open(path, true);
+  if(trace == nullptr)
+    return 1;
 
-  infile.open(path);
-  SimpleRequest* req = new SimpleRequest(0, 0);
-  while (infile >> t >> id >> size)
-    {
-        reqs++;
-        
-        req->reinit(id,size);
-        if(webcache->lookup(req)) {
-            hits++;
-        } else {
-            webcache->admit(req);
-        }
+  // offline policies read the next accesses of an annotated trace
+  for(auto& run : runs) {
+    if(run.cache->needsNextAccess() && !trace->isAnnotated()) {
+      cerr << run.cacheType << " needs a trace annotated with next accesses"
+           << " (see traceparser/annotate_trace)" << endl;
+      return 1;
+    }
+    if(run.cache->needsNextAccess() && (options.sampleRate < 1.0 || options.sampleSize > 0)) {
+      cerr << run.cacheType << " can't replay a sampled trace" << endl;
+      return 1;
     }
+  }
 
-  delete req;
+  // binary traces of remapped ids declare their id bound in the header
+  if(idCount == 0)
+    idCount = trace->getIdCount();
+  if(idCount > 0) {
+    cerr << "dense ids below " << idCount << endl;
+    for(auto& run : runs)
+      run.cache->setDenseIds(idCount);
+  }
 
-  infile.close();
-  cout << cacheType << " " << cache_size << " " << paramSummary << " "
-       << reqs << " " << hits << " "
-       << double(hits)/reqs << endl;
+  cerr << "running..." << endl;
+
+  replayTrace(*trace, runs, options);
+  if(trace->failed())
+    return 1;
+
+  for(auto& run : runs) {
+    cout << run.cacheType << " " << run.cacheSize << " " << run.paramSummary << " "
+         << run.reqs << " " << run.hits << " "
+         << double(run.hits)/run.reqs << endl;
+  }
 
   return 0;
 }